@@ -0,0 +1,283 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pdp8.h"
+
+void initOutputBuffer(OutputBuffer* buf) {
+    buf->size = 1024;
+    buf->cur = 0;
+    buf->buf = (char*) calloc(buf->size, sizeof(char));
+}
+
+void freeOutputBuffer(OutputBuffer* buf) {
+    free(buf->buf);
+    buf->buf = NULL;
+}
+
+void outputToBuffer(OutputBuffer* buf, char c) {
+    if (buf->size == buf->cur + 1) {
+        buf->buf = realloc(buf->buf, (buf->size <<= 1));
+    }
+    buf->buf[buf->cur] = c;
+    ++buf->cur;
+    buf->buf[buf->cur] = '\0'; // realloc does not clear the new part
+}
+
+// Check if it is hex digit
+int isHex(char c) {
+    return ('0' <= c && c <= '9') || ('a' <= c && c <= 'f') || ('A' <= c && c <= 'F');
+}
+
+// Parse object file
+int parseObjectFile(const char* filename, MachineStatus* machineStatus) {
+    FILE* obj = fopen(filename, "r"); // Open object file
+    if (!obj) {
+        fprintf(stderr, "Cannot open object file \"%s\"\n", filename);
+        return -1;
+    }
+    int result = parseObjectStream(obj, machineStatus);
+    fclose(obj);
+    return result;
+}
+
+// Parse an object file that is already open
+int parseObjectStream(FILE* obj, MachineStatus* machineStatus) {
+    int epSet = 0; // EP set
+    char buf[1024];
+    while (fgets(buf, sizeof(buf), obj)) {
+        if (!strcmp(buf, "\n") || !strcmp(buf, "\r\n")) { // Skip empty line
+            continue;
+        }
+        if (!strncmp(buf, "EP: ", 4)) { // EP: HEX
+            if (epSet == 1 ||
+                    !isHex(buf[4]) ||
+                    !isHex(buf[5]) ||
+                    !isHex(buf[6]) ||
+                    (strcmp(buf + 7, "\n") && strcmp(buf + 7, "\r\n"))) {
+                fprintf(stderr, "Object file error\n> %s", buf);
+                return -1;
+            }
+            sscanf(buf + 4, "%x", &machineStatus->programCounter);
+            epSet = 1;
+        } else { // HEX: HEX
+            int location;
+            int content;
+            if (!isHex(buf[0]) ||
+                    !isHex(buf[1]) ||
+                    !isHex(buf[2]) ||
+                    strncmp(buf + 3, ": ", 2) ||
+                    !isHex(buf[5]) ||
+                    !isHex(buf[6]) ||
+                    !isHex(buf[7]) ||
+                    (strcmp(buf + 8, "\n") && strcmp(buf + 8, "\r\n"))) {
+                fprintf(stderr, "Object file error\n> %s", buf);
+                return -1;
+            }
+            sscanf(buf, "%x:%x", &location, &content);
+            machineStatus->memory[location] = content;
+        }
+    }
+    if (!epSet) {
+        fprintf(stderr, "Object file error\n> \"No EP set\"\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Addressing
+int getMemoryAddress(int instruction, MachineStatus* machineStatus) {
+    int address = instruction & 0x7F;
+    if (instruction & 0x80) { // Current page
+        address |= machineStatus->programCounter & 0x0F80;
+    }
+    if (instruction & 0x0100) { // Indirect addressing
+        address = machineStatus->memory[address];
+    }
+    // if (!(instruction & 0x80) && (instruction & 0x0100) && (0x08 <= address) && (address <=  0x0F)) {
+    //     ++machineStatus->memory[address];
+    // }
+    return address;
+}
+
+// Add instruction to output
+void appendInstructionStr(char* str, const char* rep) {
+    int len = strlen(str);
+    if (!len) {
+        strcpy(str, rep);
+    } else {
+        str[len] = ' ';
+        strcpy(str + len + 1, rep);
+    }
+}
+
+// Execute one instruction
+void stepMachine(MachineStatus* machineStatus, OutputBuffer* outputBuffer, FILE* trace) {
+    int oldProgramCounter = machineStatus->programCounter;
+    int instruction = machineStatus->memory[machineStatus->programCounter]; // Fetch instruction
+    char strInstruction[1024]; // String representation of instruction
+    memset(strInstruction, 0, sizeof(strInstruction));
+    if ((instruction >> 9) <= 5) { // Memory reference instruction
+        int address = getMemoryAddress(instruction, machineStatus); // Effective address
+        switch (instruction >> 9) {
+            case 0: // AND
+                machineStatus->reg &= machineStatus->memory[address];
+                appendInstructionStr(strInstruction, "AND");
+                break;
+            case 1: // TAD
+                machineStatus->reg += machineStatus->memory[address];
+                if (machineStatus->reg & 0x1000) { // Carry
+                    machineStatus->link = 1 - machineStatus->link;
+                    machineStatus->reg &= 0x0FFF;
+                }
+                appendInstructionStr(strInstruction, "TAD");
+                break;
+            case 2: // ISZ
+                machineStatus->memory[address] = (machineStatus->memory[address] + 1) & 0x0FFF;
+                if (!machineStatus->memory[address]) {
+                    machineStatus->programCounter = (machineStatus->programCounter + 1) & 0x0FFF;
+                }
+                appendInstructionStr(strInstruction, "ISZ");
+                break;
+            case 3: // DCA
+                machineStatus->memory[address] = machineStatus->reg;
+                machineStatus->reg = 0;
+                appendInstructionStr(strInstruction, "DCA");
+                break;
+            case 4: // JMS
+                machineStatus->memory[address] = (machineStatus->programCounter + 1) & 0x0FFF;
+                machineStatus->programCounter = address;
+                appendInstructionStr(strInstruction, "JMS");
+                break;
+            case 5: // JMP
+                machineStatus->programCounter = (address - 1) & 0x0FFF;
+                appendInstructionStr(strInstruction, "JMP");
+                machineStatus->time -= 1;
+                break;
+        }
+        machineStatus->time += 2;
+        if (instruction & 0x0100) { // Indirect addressing
+            appendInstructionStr(strInstruction, "I");
+            machineStatus->time += 1;
+        }
+    } else if ((instruction >> 9) == 0x07) { // Operate instruction
+        if (instruction & 0x0100) { // Group 2
+            if (instruction & 0x01) { // EAE, illegal
+                machineStatus->halt = 1;
+                appendInstructionStr(strInstruction, "EAE");
+            } else {
+                int skip = 0; // Skip next instruction
+                if (instruction & 0x40) { // SMA
+                    if (machineStatus->reg & 0x0800) {
+                        skip = 1;
+                    }
+                    appendInstructionStr(strInstruction, "SMA");
+                }
+                if (instruction & 0x20) { // SZA
+                    if (!machineStatus->reg) {
+                        skip = 1;
+                    }
+                    appendInstructionStr(strInstruction, "SZA");
+                }
+                if (instruction & 0x10) { // SNL
+                    if (machineStatus->link) {
+                        skip = 1;
+                    }
+                    appendInstructionStr(strInstruction, "SNL");
+                }
+                if (instruction & 0x08) { // RSS
+                    skip = 1 - skip;
+                    appendInstructionStr(strInstruction, "RSS");
+                }
+                if (instruction & 0x80) { // CLA
+                    machineStatus->reg = 0;
+                    appendInstructionStr(strInstruction, "CLA");
+                }
+                if (skip) {
+                    machineStatus->programCounter = (machineStatus->programCounter + 1) & 0x0FFF;
+                }
+                if (instruction & 0x02) { // HLT
+                    machineStatus->halt = 1;
+                    appendInstructionStr(strInstruction, "HLT");
+                }
+                if (instruction & 0x04) { // OSR
+                    appendInstructionStr(strInstruction, "OSR");
+                }
+            }
+        } else { // Group 1
+            if ((instruction & 0x0C) == 0x0C) { // Both RAR and RAL, illegal
+                machineStatus->halt = 1;
+                appendInstructionStr(strInstruction, "RAR RAL");
+            } else {
+                if (instruction & 0x80) { // CLA
+                    machineStatus->reg = 0;
+                    appendInstructionStr(strInstruction, "CLA");
+                }
+                if (instruction & 0x40) { // CLL
+                    machineStatus->link = 0;
+                    appendInstructionStr(strInstruction, "CLL");
+                }
+                if (instruction & 0x20) { // CMA
+                    machineStatus->reg = ~machineStatus->reg & 0x0FFF;
+                    appendInstructionStr(strInstruction, "CMA");
+                }
+                if (instruction & 0x10) { // CML
+                    machineStatus->link = 1 - machineStatus->link;
+                    appendInstructionStr(strInstruction, "CML");
+                }
+                if (instruction & 0x01) { // IAC
+                    ++machineStatus->reg;
+                    if (machineStatus->reg & 0x1000) { // Carry
+                        machineStatus->link = 1 - machineStatus->link;
+                        machineStatus->reg &= 0x0FFF;
+                    }
+                    appendInstructionStr(strInstruction, "IAC");
+                }
+                if (instruction & 0x0C) { // Rotate
+                    int rotate = 1;
+                    if (instruction & 0x02) { // Rotate two bits
+                        rotate = 2;
+                    }
+                    if (instruction & 0x08) { // RAR or RTR
+                        machineStatus->reg = (machineStatus->reg | (machineStatus->link << 12) | ((machineStatus->reg & 0x03) << 13)) >> rotate;
+                        appendInstructionStr(strInstruction, rotate == 1 ? "RAR" : "RTR");
+                    } else { // RAL or RTL
+                        machineStatus->reg = (machineStatus->reg | (machineStatus->link << 12)) << rotate;
+                        machineStatus->reg |= machineStatus->reg >> 13;
+                        appendInstructionStr(strInstruction, rotate == 1 ? "RAL" : "RTL");
+                    }
+                    machineStatus->link = (machineStatus->reg & 0x1000) >> 12;
+                    machineStatus->reg &= 0x0FFF;
+                }
+            }
+        }
+        machineStatus->time += 1;
+    } else { // Input-output instruction
+        int device = (instruction & 0x01F8) >> 3;
+        char buf[1024];
+        memset(buf, 0, sizeof(buf));
+        if (device == 3) {
+            machineStatus->reg = getchar() & 0x0FFF;
+        } else if (device == 4) {
+            outputToBuffer(outputBuffer, machineStatus->reg & 0xFF);
+        } else { // Illegal
+            machineStatus->halt = 1;
+        }
+        sprintf(buf, "IOT %d", device);
+        appendInstructionStr(strInstruction, buf);
+        machineStatus->time += 1;
+    }
+    if (trace) {
+        fprintf(trace, "Time %lld: PC=0x%03X instruction = 0x%03X (%s), rA = 0x%03X, rL = %d\n", machineStatus->time, oldProgramCounter, instruction, strInstruction, machineStatus->reg, machineStatus->link & 0x01);
+    }
+    machineStatus->programCounter = (machineStatus->programCounter + 1) & 0x0FFF; // Update program counter
+}
+
+// Execute until halt (or the time limit)
+int runMachine(MachineStatus* machineStatus, OutputBuffer* outputBuffer, FILE* trace, long long int limit) {
+    while (!machineStatus->halt) {
+        if (limit > 0 && machineStatus->time >= limit) {
+            return 0;
+        }
+        stepMachine(machineStatus, outputBuffer, trace);
+    }
+    return 1;
+}
@@ -0,0 +1,42 @@
+#ifndef PDP8_H
+#define PDP8_H
+
+#include <stdio.h>
+
+// Machine status
+typedef struct {
+    int link;
+    int reg;
+    int programCounter;
+    int memory[4096];
+    long long int time; // Cycles so far
+    int halt;
+} MachineStatus;
+
+// Buffer for output
+typedef struct {
+    int size;
+    int cur;
+    char* buf;
+} OutputBuffer;
+
+// The simulator core, shared by main (which loads an object file) and
+// by drivers that load memory themselves (lab5/run8 assembles straight
+// into it).
+
+void initOutputBuffer(OutputBuffer* buf);
+void freeOutputBuffer(OutputBuffer* buf);
+void outputToBuffer(OutputBuffer* buf, char c);
+
+// Parse object file into memory and the program counter; 0 if good
+int parseObjectFile(const char* filename, MachineStatus* machineStatus);
+int parseObjectStream(FILE* obj, MachineStatus* machineStatus);
+
+// Execute one instruction; with trace, print it there (the -v format)
+void stepMachine(MachineStatus* machineStatus, OutputBuffer* outputBuffer, FILE* trace);
+
+// Execute until halt, or until time reaches limit (0 for no limit);
+// returns 1 if halted
+int runMachine(MachineStatus* machineStatus, OutputBuffer* outputBuffer, FILE* trace, long long int limit);
+
+#endif
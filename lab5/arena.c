@@ -0,0 +1,66 @@
+/*
+   Assembler for PDP-8.  Simple arena (bump) allocator.
+*/
+
+#include "asm8.h"
+#include "arena.h"
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+#define ARENA_BLOCK_SIZE 16384
+
+/* keep everything we hand out aligned for any type */
+#define ARENA_ALIGN(n) (((n) + 15) & ~((size_t)15))
+
+#define BLOCK_DATA(b) (CAST(char *, (b)) + ARENA_ALIGN(sizeof(struct arena_block)))
+
+void *arena_alloc(Arena *a, size_t n)
+{
+    struct arena_block *b = a->blocks;
+
+    n = ARENA_ALIGN(n);
+    if ((b == NULL) || (b->used + n > b->size))
+        {
+            /* need a new block; big requests get a block of their own */
+            size_t size = (n > ARENA_BLOCK_SIZE) ? n : ARENA_BLOCK_SIZE;
+            b = CAST(struct arena_block *, malloc(ARENA_ALIGN(sizeof(struct arena_block)) + size));
+            if (b == NULL)
+                {
+                    fprintf(stderr, "out of memory\n");
+                    exit(1);
+                }
+            b->size = size;
+            b->used = 0;
+            a->allocated += size;
+            b->next = a->blocks;
+            a->blocks = b;
+        }
+
+    void *p = BLOCK_DATA(b) + b->used;
+    b->used += n;
+    return(p);
+}
+
+/* copy n characters of s into the arena, and terminate it */
+char *arena_strndup(Arena *a, const char *s, int n)
+{
+    char *p = CAST(char *, arena_alloc(a, n+1));
+    memcpy(p, s, n);
+    p[n] = '\0';
+    return(p);
+}
+
+void arena_release(Arena *a)
+{
+    while (a->blocks != NULL)
+        {
+            struct arena_block *b = a->blocks;
+            a->blocks = b->next;
+            free(b);
+        }
+    a->allocated = 0;
+}
@@ -0,0 +1,39 @@
+/*
+   Assembler for PDP-8.  Simple arena (bump) allocator.
+*/
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* An arena hands out memory from large blocks, and never frees
+   individual pieces.  Everything in the arena is released at once
+   by arena_release. */
+
+struct arena_block
+{
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+    /* data follows */
+};
+
+struct arena
+{
+    struct arena_block *blocks;
+    size_t allocated;           /* bytes in all the blocks */
+};
+typedef struct arena Arena;
+
+/* prototypes */
+void *arena_alloc(Arena *a, size_t n);
+char *arena_strndup(Arena *a, const char *s, int n);
+void arena_release(Arena *a);
+
+#endif
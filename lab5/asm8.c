@@ -11,9 +11,11 @@
    operate:  CLA, CLL, CMA, CML, RAR, RAL, IAC, SMA, SZA, SNL, OSR, HLT,
              NOP, SPA, SNA, SZL, SKP  RTR, RTL
    i/o:      IOT
-   pseudo:   ORIG, END, INT
+   pseudo:   ORIG, END, INT, and with -r GLOBAL, EXTERN
 
    symbols are labels and constants -- decimal, octal, hex, char
+
+   operands can be expressions of symbols and constants (see expr.h)
 */
 
 /* ***************************************************************** */
@@ -22,13 +24,16 @@
 /* ***************************************************************** */
 
 #include "asm8.h"
+#include "error.h"
 #include "token.h"
 #include "symbol.h"
 #include "opcode.h"
 #include "objmem.h"
-
-Boolean debug = FALSE;
-int number_of_errors = 0;
+#include "macro.h"
+#include "literal.h"
+#include "expr.h"
+#include "stats.h"
+#include "intern.h"
 
 /* ***************************************************************** */
 /*                                                                   */
@@ -56,52 +61,19 @@ STRING remember_string(const STRING name)
 /*                                                                   */
 /* ***************************************************************** */
 
-INST Adjust_for_ZC(Address pc, INST instruction, Address addr)
-{
-    Address addr_page = (addr & 0xF80);
-    Address curr_page = (pc & 0xF80);
-    /* set the Z/C bit for this address */
-    if (addr_page == 0)
-        {
-            /* set Z/C bit to zero */
-            instruction = instruction & ~(0x080);
-        }
-    else if (addr_page == curr_page)
-        {
-            /* set Z/C bit to one */
-            instruction = instruction | 0x080;
-        }
-    else
-        {
-            number_of_errors += 1;
-            fprintf(stderr, "Address is not on zero or current page: Address page = 0x%3X, Current page = 0x%3X\n",
-                    addr_page, curr_page);
-        }
-
-    /* add in address page offset to the instruction */
-    instruction = instruction | (addr & 0x07F);
-
-    return(instruction);
-}
-
-
-/* ***************************************************************** */
-
-/* where the current instruction should go in memory */
-Address location_counter = 0;
-
-/* The instruction being assembled */
-INST instruction;
+/* The assembly keeps where the current instruction should go in
+   memory (location_counter) and the instruction being assembled
+   (instruction).
 
-/* As we assemble the instruction, the bits may be either fixed
+   As we assemble the instruction, the bits may be either fixed
    (as either 0 or 1), or not yet known.  For example if we have
    SMA, we know it is an operate group 2, and the SMA bit is set,
    but we don't know which (if any) of the other group 2 opcodes
    will be set.  So we know the opcode (0x111...)  and the group
    2 opcode bit (0x...1....), and the SMA bit (0x.....1...), but
    the other bits are not known (and hence are not yet fixed).
+   Those we do know are in fixed_bits.
 */
-INST fixed_bits;
 
 
 /* ***************************************************************** */
@@ -109,88 +81,136 @@ INST fixed_bits;
 /*                                                                   */
 /* ***************************************************************** */
 
-void do_opcode(Token *t)
+void do_opcode(Assembly *a, Token *t)
 {
     switch (t->op->class)
         {
         case k_indirect:
-            good_stuff = FALSE;
-            number_of_errors += 1;
-            fprintf(stderr, "Missing memory reference opcode with apparent indirect address\n");
+            a->good_stuff = FALSE;
+            Report_Error(a, a->line_number, "Missing memory reference opcode with apparent indirect address");
+            get_token(a, t);
             break;
 
         case k_memref:
             {
                 Address addr;
 
-                good_stuff = TRUE;
+                a->good_stuff = TRUE;
                 /* first the opcode */
-                instruction = t->op->value;
+                a->instruction = t->op->value;
 
                 /* check for indirect */
-                get_token(t);
+                get_token(a, t);
                 if ((t->type == Topcode) && (t->op->class == k_indirect))
                     {
-                        instruction = instruction | t->op->value;
-                        get_token(t);
+                        a->instruction = a->instruction | t->op->value;
+                        get_token(a, t);
+                    }
+
+                if (t->type == Tleft)
+                    {
+                        /* a literal: its word in the page's pool is found
+                           at the end of the assembly (Place_Literals) */
+                        get_token(a, t);
+                        parse_operand(a, t);
+                        if (t->type == Tconstant)
+                            literal_reference(a, a->location_counter, NULL, NULL, t->value, FALSE, a->line_number);
+                        else if (t->type == Tsymbol)
+                            literal_reference(a, a->location_counter,
+                                              declare_symbol(a, t->name, a->line_number),
+                                              NULL, 0, FALSE, a->line_number);
+                        else if (t->type == Texpression)
+                            literal_reference(a, a->location_counter, NULL, t->ex, 0, FALSE, a->line_number);
+                        else
+                            {
+                                Report_Error(a, a->line_number, "Literal must be constant or symbol");
+                            }
+
+                        get_token(a, t);
+                        if (t->type != Tright)
+                            {
+                                Report_Error(a, a->line_number, "Missing ) after literal");
+                                break;
+                            }
+
+                        /* new token for further processing */
+                        get_token(a, t);
+                        break;
                     }
 
+                symbol *sy = NULL;
+                const struct expression *e = NULL;
+                parse_operand(a, t);
                 if (t->type == Tconstant)
                     {
                         addr = t->value;
                     }
                 else if (t->type == Tsymbol)
                     {
-                        if ((t->sy == NULL) || (t->sy->fr != NULL))
+                        if ((t->sy == NULL) || !t->sy->defined)
                             {
-                                forward_reference(t->token_string, line_number, location_counter, FALSE);
+                                forward_reference(a, t->name, a->line_number, a->location_counter, FALSE);
                             }
+                        sy = t->sy;
                         addr = t->value;
                     }
+                else if (t->type == Texpression)
+                    {
+                        /* as for a symbol: the instruction is finished when
+                           its symbols are known; a relocatable address
+                           is only carried along for a link */
+                        if (t->sy != NULL)
+                            {
+                                add_expression_fixup(a, t->ex, a->location_counter, FALSE, a->line_number);
+                                addr = 0;
+                            }
+                        else
+                            addr = t->value;
+                        e = t->ex;
+                    }
                 else
                     {
-                        number_of_errors += 1;
-                        fprintf(stderr, "Memory reference instruction operand must be constant or symbol\n");
+                        Report_Error(a, a->line_number, "Memory reference instruction operand must be constant or symbol");
                         addr = 0;
                     }
 
-                instruction = Adjust_for_ZC(location_counter, instruction, addr);
+                /* anything not on this page or page zero goes through a link */
+                a->instruction = memory_reference(a, a->location_counter, a->instruction, sy, e, addr, a->line_number);
 
                 /* new token for further processing */
-                get_token(t);
+                get_token(a, t);
                 break;
             }
 
         case k_operate:
         case k_operate1:
         case k_operate2:
-            good_stuff = TRUE;
+            a->good_stuff = TRUE;
             /* if we have operate1 or operate2, then we know the
                top 4 bits; otherwise we only know the top 3 bits (so far) */
             if (t->op->class == k_operate)
-                fixed_bits = 0xE00;
+                a->fixed_bits = 0xE00;
             else
-                fixed_bits = 0xF00;
-            instruction = t->op->value & fixed_bits;
+                a->fixed_bits = 0xF00;
+            a->instruction = t->op->value & a->fixed_bits;
 
             /* get all the opcodes for the micro-opcodes and OR them together */
             /* but don't allow opcodes that define bits in conflict with each other */
             do {
                 /* check if more than one wants to define some bits */
-                INST conflicts = fixed_bits & t->op->mask;
+                INST conflicts = a->fixed_bits & t->op->mask;
                 if (conflicts != 0)
                     {
                         /* see if they both want the bits the same, or different */
-                        if ((instruction & conflicts) != (t->op->value & conflicts))
+                        if ((a->instruction & conflicts) != (t->op->value & conflicts))
                             {
-                                number_of_errors += 1;
-                                fprintf(stderr, "incompatible opcodes at line %d\n", line_number);
+                                Report_Error(a, a->line_number, "incompatible opcodes");
                             }
                     }
-                instruction = instruction | t->op->value;
-                fixed_bits = fixed_bits | t->op->mask;
+                a->instruction = a->instruction | t->op->value;
+                a->fixed_bits = a->fixed_bits | t->op->mask;
 
-                get_token(t);
+                get_token(a, t);
             } while (t->type == Topcode);
             break;
 
@@ -200,83 +220,124 @@ void do_opcode(Token *t)
                 int function = 0;
 
                 /* IO instruction;  IOT device function */
-                good_stuff = TRUE;
-                instruction = t->op->value;
+                a->good_stuff = TRUE;
+                a->instruction = t->op->value;
 
-                get_token(t);
+                get_token(a, t);
+                parse_operand(a, t);
                 if (t->type != Tconstant)
                     {
-                        number_of_errors += 1;
-                        fprintf(stderr, "IOT device operand must be constant\n");
+                        Report_Error(a, a->line_number, "IOT device operand must be constant");
                     }
                 else
                     device = t->value;
-                instruction = instruction | ((device & 0x3F) << 3);
+                a->instruction = a->instruction | ((device & 0x3F) << 3);
 
                 // Comma in the middle
-                get_token(t);
+                get_token(a, t);
                 if (t->type == Tcolon) {
-                    get_token(t);
+                    get_token(a, t);
                 }
+                parse_operand(a, t);
 
                 if (t->type != Tconstant)
                     {
-                        number_of_errors += 1;
-                        fprintf(stderr, "IOT function operand must be constant\n");
+                        Report_Error(a, a->line_number, "IOT function operand must be constant");
                     }
                 else
                     function = t->value;
-                instruction = instruction | (function & 0x3);
+                a->instruction = a->instruction | (function & 0x3);
 
                 /* get the next token, for the return */
-                get_token(t);
+                get_token(a, t);
                 break;
             }
 
         case k_orig:
             /* ORIG value */
-            good_stuff = FALSE;
+            a->good_stuff = FALSE;
 
-            get_token(t);
-            if (t->type != Tconstant)
+            get_token(a, t);
+            parse_operand(a, t);
+            if ((t->type == Texpression) && (t->sy == NULL))
                 {
-                    number_of_errors += 1;
-                    fprintf(stderr, "ORIG operand must be constant\n");
+                    /* an address in a relocatable module, such as . + 10 */
+                    a->location_counter = t->value & 0xFFF;
+                }
+            else if (t->type != Tconstant)
+                {
+                    Report_Error(a, a->line_number, "ORIG operand must be constant");
                 }
             else
-                location_counter = t->value;
+                a->location_counter = t->value & 0xFFF;
 
             /* get the next token, for the return */
-            get_token(t);
+            get_token(a, t);
             break;
 
         case k_end:
             /* END value  or END symbol */
-            good_stuff = FALSE;
+            a->good_stuff = FALSE;
 
-            get_token(t);
+            get_token(a, t);
+            parse_operand(a, t);
+            a->entry_given = TRUE;
             if (t->type == Tconstant)
                 {
-                    entry_point = t->value;
+                    a->entry_point = t->value;
+                }
+            else if ((t->type == Tsymbol) && a->relocatable)
+                {
+                    /* the linker will know where it is */
+                    a->entry_symbol = declare_symbol(a, t->name, a->line_number);
                 }
             else if (t->type == Tsymbol)
                 {
-                    if ((t->sy == NULL) || (t->sy->fr != NULL))
+                    if ((t->sy == NULL) || !t->sy->defined)
                         {
-                            forward_reference(t->token_string, line_number, location_counter, TRUE);
+                            forward_reference(a, t->name, a->line_number, a->location_counter, TRUE);
                         }
-                    entry_point = t->value;
+                    a->entry_point = t->value;
                 }
             else
                 {
-                    number_of_errors += 1;
-                    fprintf(stderr, "END operand must be constant or symbol\n");
+                    Report_Error(a, a->line_number, "END operand must be constant or symbol");
+                    a->entry_given = FALSE;
                 }
 
             /* get the next token, for the return */
-            get_token(t);
+            get_token(a, t);
             break;
 
+        case k_global:
+        case k_extern:
+            {
+                /* GLOBAL symbol, ...  or  EXTERN symbol, ...
+                   for linking relocatable modules (see reloc.c);
+                   only a relocatable assembly has them (token.c) */
+                enum opcode_kind kind = t->op->class;
+                a->good_stuff = FALSE;
+
+                get_token(a, t);
+                while (t->type == Tsymbol)
+                    {
+                        symbol *s = declare_symbol(a, t->name, a->line_number);
+                        if (kind == k_global)
+                            s->global = TRUE;
+                        else if (s->defined)
+                            {
+                                Report_Error(a, a->line_number, "EXTERN symbol %s already defined", s->name);
+                            }
+                        else
+                            s->external = TRUE;
+
+                        get_token(a, t);
+                        if (t->type == Tcolon)
+                            get_token(a, t);
+                    }
+                break;
+            }
+
         }
 
 }
@@ -286,99 +347,120 @@ void do_opcode(Token *t)
 /*                                                                   */
 /* ***************************************************************** */
 
-void Assemble_File(STRING name)
+void Assemble_File(Assembly *a)
 {
     Token t1;
-    t1.token_string = NULL;
 
-    number_of_errors = 0;
-    line_number = 0;
+    a->number_of_errors = 0;
+    a->line_number = 0;
+    a->source_line_number = 0;
 
-    while (get_next_line() != EOF)
+    load_input_file(a);
+    while (get_next_line(a) != EOF)
         {
             /* get the token to process */
-            get_token(&t1);
+            get_token(a, &t1);
 
             /* look at the next token, is this a label ? */
-            enum Token_type t = peek_token_type();
+            enum Token_type t = peek_token_type(a);
             while (t == Tcolon)
                 {
-                    define_symbol(t1.token_string, location_counter);
+                    define_symbol(a, (t1.type == Tsymbol) ? t1.name : intern_name(a, t1.token_string, t1.token_length),
+                                  a->location_counter);
                     /* skip colon */
-                    get_token(&t1);
+                    get_token(a, &t1);
                     /* and get the next symbol (if any) */
-                    get_token(&t1);
-                    t = peek_token_type();
+                    get_token(a, &t1);
+                    t = peek_token_type(a);
                 }
 
             /* starting an instruction */
-            good_stuff = FALSE;
-            instruction = 0;
-            fixed_bits = 0;
+            a->good_stuff = FALSE;
+            a->instruction = 0;
+            a->fixed_bits = 0;
+            char kind = WORD_DATA;
 
-            while ((t1.type == Topcode) || (t1.type == Tsymbol) || (t1.type == Tconstant))
+            while ((t1.type == Topcode) || (t1.type == Tsymbol) || (t1.type == Tconstant)
+                   || (t1.type == Toperator) || (t1.type == Tdot))
                 {
                     /* not a label -- do what you can for it */
                     switch (t1.type)
                         {
                         case Topcode:
                             /* if we already have good stuff here, why do we have another opcode? */
-                            if (good_stuff)
+                            if (a->good_stuff)
                                 {
-                                    number_of_errors += 1;
-                                    fprintf(stderr, "yet another opcode at line %d\n", line_number);
+                                    Report_Error(a, a->line_number, "yet another opcode");
                                 }
 
-                            do_opcode(&t1);
+                            do_opcode(a, &t1);
+                            kind = WORD_INSTRUCTION;
                             /* do_opcode will advance the token */
                             break;
 
                         case Tsymbol:
-                            if ((t1.sy == NULL) || (t1.sy->fr != NULL))
+                        case Tconstant:
+                        case Toperator:
+                        case Tdot:
+                            parse_operand(a, &t1);
+                            /* a relocatable module also needs to tell the
+                               linker about each address it uses */
+                            if ((t1.type == Tsymbol) && ((t1.sy == NULL) || !t1.sy->defined || a->relocatable))
                                 {
-                                    forward_reference(t1.token_string, line_number, location_counter, TRUE);
+                                    forward_reference(a, t1.name, a->line_number, a->location_counter, TRUE);
                                 }
+                            else if (t1.type == Texpression)
+                                {
+                                    add_expression_fixup(a, t1.ex, a->location_counter, TRUE, a->line_number);
+                                }
+                            else if (t1.type == Toperator)
+                                {
+                                    Report_Error(a, a->line_number, "illegal token");
+                                    t1.type = Tillegal;
+                                    break;
+                                }
+                            else if (t1.type == Tillegal)
+                                break;
 
-                        case Tconstant:
                             /* if we already have good stuff here, why do we have another constant
                                or symbol ? */
-                            if (good_stuff)
+                            if (a->good_stuff)
                                 {
-                                    number_of_errors += 1;
-                                    fprintf(stderr, "illegal token at line %d\n", line_number);
+                                    Report_Error(a, a->line_number, "illegal token");
                                 }
 
-                            good_stuff = TRUE;
-                            instruction = (t1.value & 0xFFF);
-                            fixed_bits = 0xFFF;
-                            get_token(&t1);
+                            a->good_stuff = TRUE;
+                            a->instruction = (t1.value & 0xFFF);
+                            a->fixed_bits = 0xFFF;
+                            kind = (t1.type == Tsymbol) ? WORD_ADDRESS : WORD_DATA;
+                            get_token(a, &t1);
                             break;
 
                         default:
-                            number_of_errors += 1;
-                            fprintf(stderr, "illegal token at line %d\n", line_number);
+                            Report_Error(a, a->line_number, "illegal token");
                             t1.type = Tillegal;
                             break;
                         }
                 }
 
             /* check if this line is just a comment */
-            finish_this_line(location_counter, instruction);
+            finish_this_line(a);
 
-            if (good_stuff)
+            if (a->good_stuff)
                 {
-                    Define_Object_Code(location_counter, instruction, FALSE);
-                    location_counter += 1;
+                    Define_Object_Code(a, a->location_counter, a->instruction, FALSE);
+                    a->word_kind[a->location_counter & 0xFFF] = kind;
+                    a->location_counter = (a->location_counter + 1) & 0xFFF;
                 }
         }
 
-    /* last little bit of allocated memory */
-    if (t1.token_string != NULL)
-        {
-            free(t1.token_string);
-            t1.token_string = NULL;
-        }
+    enum stats_phase saved = STATS_ENTER(a, PHASE_RESOLVE);
+    Resolve_Forward_References(a);
+    Place_Literals(a);
+    STATS_LEAVE(a, saved);
 
+    release_input_file(a);
+    flush_listing(a);
 }
 
 
@@ -387,108 +469,31 @@ void Assemble_File(STRING name)
 /*                                                                   */
 /* ***************************************************************** */
 
-void scanargs(STRING s)
-{
-    /* check each character of the option list for
-       its meaning. */
-
-    while (*++s != '\0')
-        switch (*s)
-            {
-
-            case 'D': /* debug option */
-                debug = TRUE;
-                break;
-
-            default:
-                fprintf (stderr,"asm: Bad option %c\n", *s);
-                fprintf (stderr,"usage: asm [-D] file\n");
-                exit(1);
-            }
-}
-
+/* set up a new assembly, reading from input, writing object code to
+   output, the listing to listing_file and error messages to errors */
 
-char *change_file_name(STRING name, STRING old_ext, STRING new_ext)
+void Initialize_Assembly(Assembly *a, FILE *input, FILE *output, FILE *listing_file, FILE *errors)
 {
-    /* need enough space for the new extension */
-    int n = strlen(name) + strlen(old_ext) + 1;
-
-    /* make the copy */
-    char *news = malloc(n);
-    strcpy(news, name);
-
-    /* can we find the old extension in this file ? */
-    char *oldxs = strstr(news, old_ext);
-    if (oldxs == NULL)
-        {
-            /* there is no old extension; add the new extension */
-            news = strcat(news, new_ext);
-        }
-    else
-        {
-            while (*new_ext != '\0')
-                *oldxs++ = *new_ext++;
-            *oldxs = '\0';
-            /* find the old extension in the old string */
-            char *p = strstr(name, old_ext);
-            /* and add the part after that to the new string */
-            strcat(oldxs, &p[strlen(old_ext)]);
-        }
-    return(news);
+    memset(a, 0, sizeof(Assembly));
+    a->listing = TRUE;
+    a->input = input;
+    a->output = output;
+    a->listing_file = listing_file;
+    a->errors = errors;
+    a->listing_to_terminal = -1;
 }
 
-
-/* ***************************************************************** */
-/*                                                                   */
-/*                                                                   */
-/* ***************************************************************** */
-
-int main(int argc, STRING *argv)
+/* free everything the assembly allocated; the files are not closed */
+void Release_Assembly(Assembly *a)
 {
-
-    Initialize_Opcode_Table();
-
-    /* main driver program.  Define the input file
-       from either standard input or a name on the
-       command line.  Process all arguments. */
-
-    while (argc > 1)
+    release_input_file(a);
+    if (a->line_buffer != NULL)
         {
-            argc--, argv++;
-            if (**argv == '-')
-                scanargs(*argv);
-            else
-                {
-                    input = fopen(*argv,"r");
-                    if (input == NULL)
-                        {
-                            fprintf (stderr, "Can't open %s\n",*argv);
-                            continue;
-                        }
-                    char *out_filename = change_file_name(*argv, ".asm", ".out");
-                    output = fopen(out_filename,"w");
-                    if (output == NULL)
-                        {
-                            fprintf (stderr, "Can't open %s\n",out_filename);
-                            continue;
-                        }
-
-                    /* process the input assembly file */
-                    Clear_Object_Code();
-                    Assemble_File(*argv);
-                    Check_for_undefined_symbols();
-                    if (number_of_errors > 0)
-                        fprintf(stderr, "*** %d errors in assembly\n", number_of_errors);
-
-                    Output_Object_Code();
-
-                    fclose(input);
-                    fclose(output);
-                    free(out_filename);
-                }
+            free(a->line_buffer);
+            a->line_buffer = NULL;
         }
-
-    exit(0);
+    a->buffer_length = 0;
+    Release_Preprocessor(a);
+    Release_Literals(a);
+    Release_Symbol_Table(a);
 }
-
-
@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
 
 typedef short Boolean;
 #define TRUE 1
@@ -24,11 +25,6 @@ typedef char *STRING;
 #define CAST(t,e) ((t)(e))
 #define TYPED_MALLOC(t) CAST(t*, malloc(sizeof(t)))
 
-Boolean debug;
-
-FILE *input;
-FILE *output;
-
 
 STRING remember_string(const STRING name);
 
@@ -37,6 +33,10 @@ STRING remember_string(const STRING name);
 /*                                                                   */
 /* ***************************************************************** */
 
+/* Change this whenever the assembler output changes; cached results
+   (see cache.c) from other versions are then not used. */
+#define ASM8_VERSION "asm8 1.3"
+
 /* Types specific for the assembler */
 
 /* address type */
@@ -49,18 +49,130 @@ typedef short INST;
 
 
 /* ***************************************************************** */
-/* error handling */
-
-int number_of_errors;
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
 
+/* Everything about one assembly: where the input comes from, where
+   the object code, listing and error messages go, the symbol table,
+   and the (simulated) memory being assembled into.  Nothing is shared
+   between two assemblies, so several can be run at the same time. */
+
+#define LISTING_BUFFER_SIZE 65536
+#define MACRO_TABLE_SIZE 64
+
+struct assembly
+{
+    /* options */
+    Boolean debug;
+    Boolean listing;
+    Boolean relocatable;        /* -r: write a module for link8 */
+    Boolean optimize;           /* -O: the peephole optimizer */
+    int     bridge_gaps;        /* -G n: join segments n words apart */
+    Boolean cross_reference;    /* -X: note where symbols are used (xref.c) */
+
+    /* files */
+    FILE *input;
+    FILE *output;
+    FILE *listing_file;         /* normally stdout */
+    FILE *errors;               /* normally stderr */
+
+    /* error handling */
+    int number_of_errors;
+    int error_line;             /* of the one being written (error.c) */
+
+    /* the name of the source file, for finding included files */
+    STRING file_name;
+
+    /* the current input line (token.c, macro.c) */
+    char *input_buffer;
+    int   input_line_length;
+    int   line_number;
+    int   file_number;          /* of line_number: 0 for the source file,
+                                   else its INCLUDE file (macro.h) */
+    int   token_index;
+
+    /* the source file: lines read from it (token.c) */
+    int   source_line_number;
+
+    /* the whole input file, if we could read it at once (token.c) */
+    char *file_buffer;
+    long  file_length;
+    long  file_position;
+
+    /* or a line at a time (token.c) */
+    char *line_buffer;
+    int   buffer_length;
+
+    /* the listing (token.c) */
+    int  listing_length;
+    int  listing_to_terminal;
+    char listing_buffer[LISTING_BUFFER_SIZE];
+
+    /* the preprocessor: included files and macro expansions being
+       read, the macros defined, and the MACRO or REPT whose lines we
+       are collecting (macro.c) */
+    struct source_frame *frames;
+    int    frame_depth;
+    struct macro *macros[MACRO_TABLE_SIZE];
+    struct macro *defining;
+    int    defining_depth;
+    int    defining_line;
+    int    defining_count;
+    char **definition_lines;
+    int    number_of_definition_lines;
+    int    max_definition_lines;
+    struct include_use *includes;
+    struct include_cache *include_cache;
+    Boolean own_include_cache;  /* not shared; freed with the assembly */
+    Arena  macro_space;
+    long   expanded_lines;      /* from MACROs and REPTs, so far */
+
+    /* The assembled instruction.  Plus do we actually have
+       anything (good_stuff) or is there no output. (asm8.c) */
+    Address location_counter;
+    INST    instruction;
+    INST    fixed_bits;
+    Boolean good_stuff;
+
+    /* every identifier, once, folded to upper case (intern.c) */
+    struct interned_name **names;
+    int    number_of_names;
+    int    max_names;           /* the size of names, a power of 2 */
+
+    /* symbol table and forward references (symtab.c).  The names,
+       symbols, fixups and expressions are all in symbol_space, and
+       freed together. */
+    struct symbol_table_entry *Root_ST;
+    struct fixup *fixups;
+    int number_of_fixups;
+    int max_fixups;
+    Arena symbol_space;
+
+    /* literals and links, for the current-page pools (literal.c) */
+    struct literal_ref *literals;
+    int number_of_literals;
+    int max_literals;
+
+    /* object code (objmem.c) */
+    INST     memory[4096];
+    unsigned long long defined_bits[4096 / 64];   /* a bit per word */
+    char     word_kind[4096];   /* WORD_DATA, ... (objmem.h) */
+    Address  entry_point;
+    Boolean  entry_given;       /* END had an operand */
+    struct symbol_table_entry *entry_symbol;   /* relocatable: END symbol */
+
+    /* -S: where the time and memory go (stats.c); NULL if not wanted */
+    struct asm_stats *stats;
+};
+typedef struct assembly Assembly;
 
-/* The assembled instruction.  Plus do we actually have
-   anything (good_stuff) or is there no output. */
-Boolean good_stuff;
 
 /* ***************************************************************** */
 /* prototypes */
-INST Adjust_for_ZC(Address pc, INST instruction, Address addr);
+void Initialize_Assembly(Assembly *a, FILE *input, FILE *output, FILE *listing_file, FILE *errors);
+void Release_Assembly(Assembly *a);
+void Assemble_File(Assembly *a);
 
 
 #endif
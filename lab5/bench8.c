@@ -0,0 +1,243 @@
+/*
+  bench8 -- how fast the assembler is, phase by phase.
+
+  Reads one source file (see gen8.c for making a big one) and times
+  three phases of assembling it, each repeated, and each in its own
+  process, so the peak memory (RSS) of each can be told apart:
+
+  tokenize   reading lines and breaking them into tokens, as
+             Assemble_File does, but doing nothing with the tokens
+  assemble   all of Assemble_File: the tokens, the symbol table and
+             forward references, and the object code in memory.  The
+             symbol table's share is about assemble - tokenize.
+  output     writing the object file (Output_Object_Code), from one
+             assembly, to /dev/null
+
+  usage: bench8 [-r repetitions] file.asm
+
+  Build with the same CFLAGS as asm8 (make CFLAGS=-O2 bench) to
+  measure the assembler that will be used.
+*/
+
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "asm8.h"
+#include "input.h"
+#include "token.h"
+#include "opcode.h"
+#include "symbol.h"
+#include "objmem.h"
+#include "macro.h"
+
+int repetitions = 20;
+
+/* the source file, read once */
+char *source;
+long  source_length;
+long  source_lines;
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+double seconds_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return(t.tv_sec + t.tv_nsec / 1e9);
+}
+
+/* a fresh assembly of the source; the assembly frees its copy */
+Assembly *new_assembly(FILE *output, FILE *errors)
+{
+    Assembly *a = TYPED_MALLOC(Assembly);
+    Initialize_Assembly(a, NULL, output, NULL, errors);
+    a->listing = FALSE;
+    a->file_name = CAST(STRING, "bench");
+    a->file_buffer = CAST(char *, malloc(source_length + 1));
+    memcpy(a->file_buffer, source, source_length + 1);
+    a->file_length = source_length;
+    return(a);
+}
+
+void free_assembly(Assembly *a)
+{
+    Release_Assembly(a);
+    free(a);
+}
+
+
+/* ***************************************************************** */
+
+/* each phase returns the seconds it took for all the repetitions */
+
+double tokenize(FILE *errors)
+{
+    double total = 0;
+    int r;
+    for (r = 0; r < repetitions; r++)
+        {
+            Assembly *a = new_assembly(NULL, errors);
+            double start = seconds_now();
+            Token t;
+            while (get_next_line(a) != EOF)
+                {
+                    do
+                        get_token(a, &t);
+                    while ((t.type != Tillegal) && (t.type != Tcomment));
+                    finish_this_line(a);
+                }
+            total += seconds_now() - start;
+            free_assembly(a);
+        }
+    return(total);
+}
+
+double assemble(FILE *errors)
+{
+    double total = 0;
+    int r;
+    for (r = 0; r < repetitions; r++)
+        {
+            Assembly *a = new_assembly(NULL, errors);
+            double start = seconds_now();
+            Clear_Object_Code(a);
+            Assemble_File(a);
+            Check_for_undefined_symbols(a);
+            total += seconds_now() - start;
+            if ((r == 0) && (a->number_of_errors > 0))
+                fprintf(errors, "bench8: %d errors in assembly\n", a->number_of_errors);
+            free_assembly(a);
+        }
+    return(total);
+}
+
+double output(FILE *errors)
+{
+    FILE *null = fopen("/dev/null", "w");
+    Assembly *a = new_assembly(null, errors);
+    Clear_Object_Code(a);
+    Assemble_File(a);
+    Check_for_undefined_symbols(a);
+
+    double start = seconds_now();
+    int r;
+    for (r = 0; r < repetitions; r++)
+        {
+            Output_Object_Code(a);
+            fflush(null);
+        }
+    double total = seconds_now() - start;
+
+    free_assembly(a);
+    fclose(null);
+    return(total);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* run one phase in a child process: it sends back its time through
+   a pipe, and its peak RSS comes from wait4 */
+
+void run_phase(const char *name, double (*phase)(FILE *errors))
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+        {
+            perror("bench8: pipe");
+            exit(1);
+        }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0)
+        {
+            close(fds[0]);
+            double seconds = phase(stderr);
+            if (write(fds[1], &seconds, sizeof(seconds)) != sizeof(seconds))
+                _exit(1);
+            _exit(0);
+        }
+    close(fds[1]);
+    if (pid < 0)
+        {
+            perror("bench8: fork");
+            exit(1);
+        }
+
+    double seconds = 0;
+    Boolean ok = (read(fds[0], &seconds, sizeof(seconds)) == sizeof(seconds));
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    wait4(pid, &status, 0, &usage);
+    if (!ok || !WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+        {
+            printf("%-10s failed\n", name);
+            return;
+        }
+
+    double per_run = seconds / repetitions;
+    printf("%-10s %10.3f ms %12.0f lines/sec %8ld KB peak RSS\n",
+           name, per_run * 1000, (per_run > 0) ? source_lines / per_run : 0.0, usage.ru_maxrss);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+void usage(void)
+{
+    fprintf(stderr, "usage: bench8 [-r repetitions] file.asm\n");
+    exit(1);
+}
+
+int main(int argc, STRING *argv)
+{
+    STRING name = NULL;
+    int i;
+    for (i = 1; i < argc; i++)
+        {
+            if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc))
+                repetitions = atoi(argv[++i]);
+            else if ((argv[i][0] != '-') && (name == NULL))
+                name = argv[i];
+            else
+                usage();
+        }
+    if ((name == NULL) || (repetitions < 1)) usage();
+
+    FILE *f = fopen(name, "r");
+    if (f == NULL)
+        {
+            fprintf(stderr, "Can't open %s\n", name);
+            exit(1);
+        }
+    source = read_all(f, &source_length);
+    fclose(f);
+
+    long k;
+    for (k = 0; k < source_length; k++)
+        if (source[k] == '\n') source_lines += 1;
+
+    Initialize_Opcode_Table();
+
+    printf("%s: %ld lines, %ld bytes, %d repetitions\n", name, source_lines, source_length, repetitions);
+    run_phase("tokenize", tokenize);
+    run_phase("assemble", assemble);
+    run_phase("output", output);
+
+    free(source);
+    exit(0);
+}
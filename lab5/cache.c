@@ -0,0 +1,159 @@
+/*
+   Assembler for PDP-8.  A persistent cache of assembly results.
+
+   If the same source is assembled again, with the same options, by
+   the same version of the assembler, we can just copy out what we
+   produced last time.  Each result is kept in its own file in the
+   cache directory, named by its key:
+
+      "A8C2"
+      object size, listing size, errors size, dependencies size
+                                   (4 bytes each, little endian)
+      object file, listing, error messages, dependencies
+*/
+
+#include <unistd.h>
+#include "asm8.h"
+#include "cache.h"
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* 64-bit FNV-1a hash; h is the hash so far, so several pieces can
+   be hashed one after another */
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME        0x100000001b3ULL
+
+Cache_Key hash_bytes(Cache_Key h, const void *p, size_t n)
+{
+    const unsigned char *s = CAST(const unsigned char *, p);
+    while (n-- > 0)
+        {
+            h ^= *s++;
+            h *= FNV_PRIME;
+        }
+    return(h);
+}
+
+/* every key starts with the assembler version, so a new version
+   never uses results from an old one */
+Cache_Key start_cache_key(void)
+{
+    return(hash_bytes(FNV_OFFSET_BASIS, ASM8_VERSION, strlen(ASM8_VERSION)));
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+#define CACHE_MAGIC "A8C2"
+#define CACHE_HEADER_SIZE 20
+
+char *cache_file_name(const char *directory, Cache_Key key, const char *suffix)
+{
+    size_t n = strlen(directory) + 32 + strlen(suffix);
+    char *name = CAST(char *, malloc(n));
+    snprintf(name, n, "%s/%016llx.a8c%s", directory, key, suffix);
+    return(name);
+}
+
+void put4(unsigned char *p, size_t n)
+{
+    p[0] = n & 0xFF;
+    p[1] = (n >> 8) & 0xFF;
+    p[2] = (n >> 16) & 0xFF;
+    p[3] = (n >> 24) & 0xFF;
+}
+
+size_t get4(const unsigned char *p)
+{
+    return(p[0] | (p[1] << 8) | (p[2] << 16) | (CAST(size_t, p[3]) << 24));
+}
+
+
+/* look for key in the cache; if it is there, fill in e and return TRUE */
+Boolean Read_Cache_Entry(const char *directory, Cache_Key key, struct cache_entry *e)
+{
+    memset(e, 0, sizeof(struct cache_entry));
+
+    char *name = cache_file_name(directory, key, "");
+    FILE *f = fopen(name, "r");
+    free(name);
+    if (f == NULL) return(FALSE);
+
+    unsigned char header[CACHE_HEADER_SIZE];
+    Boolean ok = (fread(header, 1, CACHE_HEADER_SIZE, f) == CACHE_HEADER_SIZE)
+        && (memcmp(header, CACHE_MAGIC, 4) == 0);
+
+    if (ok)
+        {
+            e->object_size = get4(&header[4]);
+            e->listing_size = get4(&header[8]);
+            e->errors_size = get4(&header[12]);
+            e->dependencies_size = get4(&header[16]);
+
+            /* read all four parts at once */
+            size_t total = e->object_size + e->listing_size + e->errors_size + e->dependencies_size;
+            char *data = CAST(char *, malloc(total + 1));
+            ok = (data != NULL) && (fread(data, 1, total, f) == total) && (getc(f) == EOF);
+            e->object = data;
+            e->listing = data + e->object_size;
+            e->errors = e->listing + e->listing_size;
+            e->dependencies = e->errors + e->errors_size;
+        }
+    fclose(f);
+
+    if (!ok) Free_Cache_Entry(e);
+    return(ok);
+}
+
+
+/* save e in the cache.  Write it to a temporary file and then rename
+   it, so no one ever sees a partial entry, even if two assemblies of
+   the same source are running at the same time. */
+void Write_Cache_Entry(const char *directory, Cache_Key key, struct cache_entry *e)
+{
+    /* the address of e is different for each thread */
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%ld.%lx", CAST(long, getpid()), CAST(unsigned long, CAST(size_t, e)));
+    char *temporary = cache_file_name(directory, key, suffix);
+    char *name = cache_file_name(directory, key, "");
+
+    FILE *f = fopen(temporary, "w");
+    if (f != NULL)
+        {
+            unsigned char header[CACHE_HEADER_SIZE];
+            memcpy(header, CACHE_MAGIC, 4);
+            put4(&header[4], e->object_size);
+            put4(&header[8], e->listing_size);
+            put4(&header[12], e->errors_size);
+            put4(&header[16], e->dependencies_size);
+
+            Boolean ok = (fwrite(header, 1, CACHE_HEADER_SIZE, f) == CACHE_HEADER_SIZE)
+                && (fwrite(e->object, 1, e->object_size, f) == e->object_size)
+                && (fwrite(e->listing, 1, e->listing_size, f) == e->listing_size)
+                && (fwrite(e->errors, 1, e->errors_size, f) == e->errors_size)
+                && (fwrite(e->dependencies, 1, e->dependencies_size, f) == e->dependencies_size);
+            if (fclose(f) != 0) ok = FALSE;
+
+            if (!ok || (rename(temporary, name) != 0))
+                remove(temporary);
+        }
+
+    free(temporary);
+    free(name);
+}
+
+
+/* only for entries filled in by Read_Cache_Entry */
+void Free_Cache_Entry(struct cache_entry *e)
+{
+    if (e->object != NULL) free(e->object);
+    memset(e, 0, sizeof(struct cache_entry));
+}
@@ -0,0 +1,42 @@
+/*
+   Assembler for PDP-8.  A persistent cache of assembly results.
+*/
+
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* Everything an assembly produces: the object file, the listing,
+   and the error messages.  The cache maps a key (a hash of the
+   assembler version, the options, and the source and its directory)
+   to one of these.
+   The source may include other files, so we also keep the names and
+   hashes of those (see Write_Include_Dependencies). */
+
+struct cache_entry
+{
+    char   *object;
+    size_t  object_size;
+    char   *listing;
+    size_t  listing_size;
+    char   *errors;
+    size_t  errors_size;
+    char   *dependencies;
+    size_t  dependencies_size;
+};
+
+typedef unsigned long long Cache_Key;
+
+/* prototypes */
+Cache_Key hash_bytes(Cache_Key h, const void *p, size_t n);
+Cache_Key start_cache_key(void);
+
+Boolean Read_Cache_Entry(const char *directory, Cache_Key key, struct cache_entry *e);
+void Write_Cache_Entry(const char *directory, Cache_Key key, struct cache_entry *e);
+void Free_Cache_Entry(struct cache_entry *e);
+
+#endif
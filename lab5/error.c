@@ -0,0 +1,27 @@
+/*
+   Assembler for PDP-8.  Error messages.  See error.h.
+*/
+
+#include <stdarg.h>
+#include "asm8.h"
+#include "error.h"
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+void Report_Error(Assembly *a, int line_number, const char *format, ...)
+{
+    a->number_of_errors += 1;
+    a->error_line = line_number;
+
+    va_list args;
+    va_start(args, format);
+    vfprintf(a->errors, format, args);
+    va_end(args);
+    if (line_number > 0)
+        fprintf(a->errors, " at line %d", line_number);
+    fputc('\n', a->errors);
+}
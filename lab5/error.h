@@ -0,0 +1,22 @@
+/*
+   Assembler for PDP-8.  Error messages.
+*/
+
+#ifndef _ERROR_H_
+#define _ERROR_H_
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* An error in the assembly is counted, and its message written to
+   a->errors, followed by " at line N" for the line it is at (if it
+   is at a line: line_number 0 is none).  The line is also left in
+   a->error_line while the message is written, so libasm8 can give it
+   with the message without reading it back out of the text. */
+
+/* prototypes */
+void Report_Error(Assembly *a, int line_number, const char *format, ...);
+
+#endif
@@ -0,0 +1,280 @@
+/*
+   Assembler for PDP-8.  Operand expressions.  See expr.h.
+*/
+
+#include "asm8.h"
+#include "error.h"
+#include "token.h"
+#include "symbol.h"
+#include "reloc.h"
+#include "arena.h"
+#include "expr.h"
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+int precedence(char op)
+{
+    switch (op)
+        {
+        case '*':
+        case '%':
+            return(4);
+        case '+':
+        case '-':
+            return(3);
+        case '&':
+            return(2);
+        case '|':
+            return(1);
+        }
+    return(0);
+}
+
+Boolean is_sign(Token *t)
+{
+    return((t->type == Toperator) && ((t->value == '-') || (t->value == '+')));
+}
+
+Boolean add_item(Assembly *a, struct expression *e, char op, symbol *sy, int value, Boolean relocatable)
+{
+    if (e->number_of_items >= MAX_EXPRESSION_ITEMS)
+        {
+            Report_Error(a, a->line_number, "Expression too long");
+            return(FALSE);
+        }
+    struct expression_item *item = &e->items[e->number_of_items++];
+    item->op = op;
+    item->relocatable = relocatable;
+    item->sy = sy;
+    item->value = value;
+    return(TRUE);
+}
+
+/* Parse an operand that starts with the token in t.  A constant or
+   symbol on its own is left as it is; an expression is evaluated,
+   and left in t as a constant if it can be, or as a Texpression.
+   Either way, t is left as the last token of the operand, as a lone
+   constant or symbol would be. */
+
+void parse_operand(Assembly *a, Token *t)
+{
+    if ((t->type != Tconstant) && (t->type != Tsymbol) && (t->type != Tdot) && !is_sign(t))
+        return;
+
+    /* a lone constant or symbol, by far the most common */
+    if (((t->type == Tconstant) || (t->type == Tsymbol)) && (peek_token_type(a) != Toperator))
+        return;
+
+    struct expression e;
+    e.number_of_items = 0;
+    char operators[MAX_EXPRESSION_ITEMS];
+    int number_of_operators = 0;
+    Boolean ok = TRUE;
+
+    while (ok)
+        {
+            /* a term: any number of signs, and then a value */
+            Boolean negate = FALSE;
+            while (is_sign(t))
+                {
+                    if (t->value == '-') negate = !negate;
+                    get_token(a, t);
+                }
+
+            if (t->type == Tconstant)
+                ok = add_item(a, &e, 0, NULL, t->value, FALSE);
+            else if (t->type == Tsymbol)
+                {
+                    symbol *sy = t->sy;
+                    if (sy == NULL)
+                        sy = declare_symbol(a, t->name, a->line_number);
+                    if (!sy->defined) sy->reference_line = a->line_number;
+                    ok = add_item(a, &e, 0, sy, 0, FALSE);
+                }
+            else if (t->type == Tdot)
+                ok = add_item(a, &e, 0, NULL, a->location_counter,
+                              a->relocatable && relocatable_address(a->location_counter));
+            else
+                {
+                    Report_Error(a, a->line_number, "Missing operand in expression");
+                    ok = FALSE;
+                }
+            if (ok && negate)
+                ok = add_item(a, &e, 'n', NULL, 0, FALSE);
+            if (!ok || (peek_token_type(a) != Toperator)) break;
+
+            /* an operator: first do those before it that bind as tightly */
+            get_token(a, t);
+            char op = t->value;
+            while (ok && (number_of_operators > 0) && (precedence(operators[number_of_operators-1]) >= precedence(op)))
+                ok = add_item(a, &e, operators[--number_of_operators], NULL, 0, FALSE);
+            operators[number_of_operators++] = op;
+
+            get_token(a, t);
+        }
+    while (ok && (number_of_operators > 0))
+        ok = add_item(a, &e, operators[--number_of_operators], NULL, 0, FALSE);
+
+    int i;
+    for (i = 0; ok && (i < e.number_of_items); i++)
+        if ((e.items[i].sy != NULL) && e.items[i].sy->external)
+            {
+                Report_Error(a, a->line_number, "EXTERN symbol %s may not be used in an expression",
+                             e.items[i].sy->name);
+                ok = FALSE;
+            }
+    if (!ok)
+        {
+            t->type = Tillegal;
+            t->value = 0;
+            return;
+        }
+
+    int relocation;
+    t->value = Evaluate_Expression(a, &e, &relocation, a->line_number);
+    t->sy = Undefined_In_Expression(&e);
+    t->ex = NULL;
+    if (t->sy != NULL)
+        t->value = 0;   /* as for a lone symbol not yet defined */
+    else
+        {
+            if (!a->relocatable || (relocation == 0))
+                {
+                    t->type = Tconstant;
+                    return;
+                }
+            if (relocation != 1)
+                {
+                    Report_Error(a, a->line_number, "Expression can not be relocated");
+                    t->type = Tconstant;
+                    return;
+                }
+        }
+
+    /* keep it, to evaluate again later */
+    size_t size = sizeof(struct expression) - sizeof(e.items) + e.number_of_items * sizeof(struct expression_item);
+    struct expression *copy = CAST(struct expression *, arena_alloc(&a->symbol_space, size));
+    memcpy(copy, &e, size);
+    t->type = Texpression;
+    t->ex = copy;
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* the first symbol in e that is not defined, or NULL */
+symbol *Undefined_In_Expression(const struct expression *e)
+{
+    int i;
+    for (i = 0; i < e->number_of_items; i++)
+        if ((e->items[i].sy != NULL) && !e->items[i].sy->defined) return(e->items[i].sy);
+    return(NULL);
+}
+
+/* The value of e, with its symbols as they are now, for the operand
+   at line_number (which may be long past, for a fixup).  relocation is
+   how many addresses in the module are in it: 0 for a constant, 1 for
+   an address, and anything else (NOT_RELOCATABLE) can't be relocated.
+   It is always 0 unless the assembly is relocatable.
+
+   The arithmetic is unsigned, so that it wraps around rather than
+   overflowing; only the low 12 bits are kept in the end anyway. */
+
+int Evaluate_Expression(Assembly *a, const struct expression *e, int *relocation, int line_number)
+{
+    unsigned int values[MAX_EXPRESSION_ITEMS];
+    int relocations[MAX_EXPRESSION_ITEMS];
+    int n = 0;
+    Boolean bad = FALSE;
+
+    int i;
+    for (i = 0; i < e->number_of_items; i++)
+        {
+            const struct expression_item *item = &e->items[i];
+            if (item->op == 0)
+                {
+                    if (item->sy != NULL)
+                        {
+                            symbol *sy = item->sy;
+                            values[n] = sy->value;
+                            relocations[n] = (a->relocatable && sy->defined && !sy->external
+                                              && relocatable_address(sy->value)) ? 1 : 0;
+                        }
+                    else
+                        {
+                            values[n] = item->value;
+                            relocations[n] = item->relocatable ? 1 : 0;
+                        }
+                    n += 1;
+                    continue;
+                }
+            if (item->op == 'n')
+                {
+                    values[n-1] = -values[n-1];
+                    relocations[n-1] = -relocations[n-1];
+                    continue;
+                }
+
+            /* a binary operator */
+            n -= 1;
+            unsigned int x = values[n-1];
+            unsigned int y = values[n];
+            int rx = relocations[n-1];
+            int ry = relocations[n];
+            switch (item->op)
+                {
+                case '+': x = x + y; rx = rx + ry; break;
+                case '-': x = x - y; rx = rx - ry; break;
+                case '*': x = x * y; break;
+                case '&': x = x & y; break;
+                case '|': x = x | y; break;
+                case '%':
+                    /* signed, as it always was; but -1 is just negation,
+                       which for the most negative x would overflow */
+                    if (CAST(int, y) == -1)
+                        x = -x;
+                    else if (y != 0)
+                        x = CAST(unsigned int, CAST(int, x) / CAST(int, y));
+                    else
+                        {
+                            if (Undefined_In_Expression(e) == NULL)
+                                {
+                                    Report_Error(a, line_number, "Division by zero in expression");
+                                }
+                            x = 0;
+                        }
+                    break;
+                }
+            if ((item->op != '+') && (item->op != '-') && ((rx != 0) || (ry != 0)))
+                bad = TRUE;
+            values[n-1] = x;
+            relocations[n-1] = rx;
+        }
+
+    *relocation = bad ? NOT_RELOCATABLE : relocations[0];
+    return(CAST(int, values[0]));
+}
+
+
+/* a forward reference (or, in a relocatable module, a use of an
+   address) that needs e evaluated when all symbols are known */
+void add_expression_fixup(Assembly *a, const struct expression *e, Address reference_address, Boolean full, int line_number)
+{
+    if (a->debug) fprintf(a->errors, "%s forward reference to an expression at line %d, address 0x%03X\n",
+                       (full ? "full" : "page"), line_number, reference_address);
+
+    symbol *sy = NULL;
+    int i;
+    for (i = 0; (i < e->number_of_items) && (sy == NULL); i++)
+        sy = e->items[i].sy;
+
+    add_fixup(a, sy, reference_address, full, line_number);
+    a->fixups[a->number_of_fixups - 1].expression = e;
+}
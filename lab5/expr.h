@@ -0,0 +1,64 @@
+/*
+   Assembler for PDP-8.  Operand expressions.
+*/
+
+#ifndef _EXPR_H_
+#define _EXPR_H_
+
+#include "token.h"
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* An operand can be an expression of constants, symbols and . (the
+   location counter), with the operators
+
+        * %     multiply, divide        (/ starts a comment)
+        + -     add, subtract
+        &       and
+        |       or
+
+   from the highest precedence to the lowest, and - in front of any
+   term.  There are no parentheses: they are for literals.
+
+   An expression is kept in postfix, so it can be evaluated again
+   once its symbols are defined: a forward reference or a literal can
+   carry the expression instead of a symbol.  parse_operand folds an
+   expression into a constant when it can; the others (Texpression)
+   are copied into the a->symbol_space arena.
+
+   In a relocatable module, an address in the module plus or minus a
+   constant is still an address in the module; the difference of two
+   is a constant.  Anything else done to an address can not be
+   relocated by the linker, and EXTERN symbols can only be used on
+   their own. */
+
+#define MAX_EXPRESSION_ITEMS 32
+
+struct expression_item
+{
+    char     op;                /* an operator, 'n' to negate; 0 for a value */
+    Boolean  relocatable;       /* . in a relocatable module */
+    symbol  *sy;                /* the value of a symbol; otherwise value */
+    int      value;
+};
+
+struct expression
+{
+    int number_of_items;
+    struct expression_item items[MAX_EXPRESSION_ITEMS];
+};
+
+/* the relocation of a value that is not just 0 (a constant) or 1
+   (an address in the module) */
+#define NOT_RELOCATABLE (-1000)
+
+/* prototypes */
+void parse_operand(Assembly *a, Token *t);
+int Evaluate_Expression(Assembly *a, const struct expression *e, int *relocation, int line_number);
+symbol *Undefined_In_Expression(const struct expression *e);
+void add_expression_fixup(Assembly *a, const struct expression *e, Address reference_address, Boolean full, int line_number);
+
+#endif
@@ -0,0 +1,454 @@
+/*
+  fuzz8 -- fuzzing the assembler, and the object file loaders, in
+  one process.
+
+  Each target takes any bytes at all, and must not crash on them:
+
+  tokens  the bytes as source, read a line at a time and broken
+          into tokens (get_next_line, get_token), as bench8 does
+  asm     the bytes assembled from memory (Assemble_Buffer), with
+          the listing and -O; and again as a relocatable module,
+          with its output and a cross reference written to /dev/null
+  obj8    the bytes as an OBJ8 file (Parse_OBJ8), as obj8dump and
+          the validator read them
+  hex     the bytes as a lab4 text object file (parseObjectStream,
+          ../lab4/pdp8.c), as the simulator reads them
+
+  usage: fuzz8 [-t target] [-n iterations] [-s seed] seed-file ...
+
+  Each seed file is tried, and then, n times, one of them is mutated
+  at random and tried.  If a target crashes, or takes more than
+  MAX_SECONDS on one input, the input is written to crash-<target>, to
+  be run again (fuzz8 -t target -n 0 crash-<target>).
+
+  make fuzz builds fuzz8 with the address and undefined behaviour
+  sanitizers, and runs each target on test cases of its kind: the
+  sources in p5grade/cases and test/cases, the OBJ8 files in
+  test/cases, and the hex object files in ../lab4/p4test/cases.
+  Inputs that once crashed are kept as test cases (big_operands.asm
+  has 2047*2047*2047, which overflowed in expr.c), so they are tried
+  again each time.
+
+  The same targets can be run by libFuzzer instead, with the target
+  named by FUZZ8_TARGET:
+
+      clang -g -O1 -fsanitize=fuzzer,address -DLIBFUZZER ${FUZZ_SOURCES} -o fuzz8-lf
+      FUZZ8_TARGET=asm ./fuzz8-lf corpus-directory
+*/
+
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include "asm8.h"
+#include "token.h"
+#include "symbol.h"
+#include "objmem.h"
+#include "macro.h"
+#include "reloc.h"
+#include "xref.h"
+#include "libasm8.h"
+#include "obj8read.h"
+#include "../lab4/pdp8.h"
+
+/* where the assemblies write what we don't want to see */
+FILE *null_file = NULL;
+
+/* with the sanitizers, stop at the first error, so the input that
+   caused it is saved (crashed, below) */
+const char *__asan_default_options(void)
+{
+    return("abort_on_error=1");
+}
+
+const char *__ubsan_default_options(void)
+{
+    return("abort_on_error=1:print_stacktrace=1");
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* an assembly of a copy of the bytes; the assembly frees the copy */
+Assembly *fuzz_assembly(const unsigned char *data, size_t size)
+{
+    Assembly *a = TYPED_MALLOC(Assembly);
+    Initialize_Assembly(a, NULL, null_file, null_file, null_file);
+    a->listing = FALSE;
+    a->file_buffer = CAST(char *, malloc(size + 1));
+    memcpy(a->file_buffer, data, size);
+    a->file_buffer[size] = '\0';
+    a->file_length = size;
+    return(a);
+}
+
+int Fuzz_Tokens(const unsigned char *data, size_t size)
+{
+    Assembly *a = fuzz_assembly(data, size);
+    Token t;
+    while (get_next_line(a) != EOF)
+        {
+            do
+                get_token(a, &t);
+            while ((t.type != Tillegal) && (t.type != Tcomment));
+            finish_this_line(a);
+        }
+    Release_Assembly(a);
+    free(a);
+    return(0);
+}
+
+int Fuzz_Assembly(const unsigned char *data, size_t size)
+{
+    struct asm8_options options;
+    memset(&options, 0, sizeof(options));
+    options.optimize = TRUE;
+    options.listing = TRUE;
+
+    struct asm8_image *image = TYPED_MALLOC(struct asm8_image);
+    Assemble_Buffer(CAST(const char *, data), size, &options, image);
+    Free_Image(image);
+    free(image);
+
+    Assembly *a = fuzz_assembly(data, size);
+    a->relocatable = TRUE;
+    a->cross_reference = TRUE;
+    Clear_Object_Code(a);
+    Assemble_File(a);
+    Check_for_undefined_symbols(a);
+    Output_Relocatable_Code(a);
+    Write_Cross_Reference(a, null_file);
+    Release_Assembly(a);
+    free(a);
+    return(0);
+}
+
+int Fuzz_OBJ8(const unsigned char *data, size_t size)
+{
+    static struct obj8_image image;
+    Parse_OBJ8(data, size, &image);
+    return(0);
+}
+
+int Fuzz_Object_Text(const unsigned char *data, size_t size)
+{
+    /* fmemopen wants at least one byte */
+    if (size == 0) return(0);
+    FILE *f = fmemopen(CAST(void *, data), size, "r");
+    if (f == NULL) return(0);
+
+    /* the simulator complains to stderr about every bad line */
+    FILE *saved = stderr;
+    stderr = null_file;
+    static MachineStatus m;
+    parseObjectStream(f, &m);
+    stderr = saved;
+    fclose(f);
+    return(0);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+struct fuzz_target
+{
+    const char *name;
+    int (*run)(const unsigned char *data, size_t size);
+    const char **dictionary;    /* pieces worth putting in */
+};
+
+const char *source_words[] =
+{
+    "\n", " ", ",", "'", "(", ")", "/", "+", "-", "*", "%", "&", "|", ".", "\"",
+    "TAD ", "JMP ", "JMS ", "ISZ ", "DCA ", " I ", "CLA ", "SMA ", "IOT ",
+    "ORIG ", "END ", "GLOBAL ", "EXTERN ", "INCLUDE ", "MACRO ", "REPT ", "ENDM\n",
+    "0x", "0FFF", "4095", "07777", "-1", "'''", "L1, ", "L1", "L2",
+    "65535", "2147483647", "4294967295", "*65535", "*2147483647", "-2147483647",
+    NULL
+};
+
+const char *obj8_words[] =
+{
+    "OBJ8", "\x03", "\x05", "\x3F\x3F", "\x3F", "\x00\x00", "\xFF", NULL
+};
+
+const char *text_words[] =
+{
+    "EP: ", ": ", "\n", "\r\n", "FFF", "000", "0", "f", "g", "EP: 000\n", "FFF: FFF\n", NULL
+};
+
+struct fuzz_target targets[] =
+{
+    { "tokens", Fuzz_Tokens, source_words },
+    { "asm",    Fuzz_Assembly, source_words },
+    { "obj8",   Fuzz_OBJ8, obj8_words },
+    { "hex",    Fuzz_Object_Text, text_words },
+    { NULL, NULL, NULL }
+};
+
+struct fuzz_target *find_target(const char *name)
+{
+    int i;
+    for (i = 0; targets[i].name != NULL; i++)
+        if (strcmp(targets[i].name, name) == 0)
+            return(&targets[i]);
+    return(NULL);
+}
+
+
+#ifdef LIBFUZZER
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+struct fuzz_target *target = NULL;
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    null_file = fopen("/dev/null", "w");
+    const char *name = getenv("FUZZ8_TARGET");
+    target = find_target((name != NULL) ? name : "asm");
+    if (target == NULL)
+        {
+            fprintf(stderr, "fuzz8: no target %s\n", name);
+            exit(1);
+        }
+    return(0);
+}
+
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size)
+{
+    return(target->run(data, size));
+}
+
+#else
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+#define MAX_INPUT 16384
+#define MAX_SECONDS 10
+
+struct fuzz_target *target;
+
+/* the input being tried, for when it crashes */
+unsigned char input[MAX_INPUT];
+size_t input_size;
+
+void crashed(int signal_number)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "crash-%s", target->name);
+    int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0)
+        {
+            if (write(fd, input, input_size) < 0) { /* nothing more to do */ }
+            close(fd);
+        }
+    const char message[] = "fuzz8: crashed; the input is in ";
+    if ((write(2, message, sizeof(message) - 1) < 0) || (write(2, name, strlen(name)) < 0)
+        || (write(2, "\n", 1) < 0)) { /* nor here */ }
+
+    signal(signal_number, SIG_DFL);
+    raise(signal_number);
+}
+
+
+/* the seeds, read once */
+unsigned char **seeds = NULL;
+size_t *seed_sizes = NULL;
+int number_of_seeds = 0;
+
+void read_seed(const char *name)
+{
+    FILE *f = fopen(name, "r");
+    if (f == NULL)
+        {
+            fprintf(stderr, "fuzz8: can't open %s\n", name);
+            return;
+        }
+    seeds = CAST(unsigned char **, realloc(seeds, (number_of_seeds + 1) * sizeof(unsigned char *)));
+    seed_sizes = CAST(size_t *, realloc(seed_sizes, (number_of_seeds + 1) * sizeof(size_t)));
+    seeds[number_of_seeds] = CAST(unsigned char *, malloc(MAX_INPUT));
+    seed_sizes[number_of_seeds] = fread(seeds[number_of_seeds], 1, MAX_INPUT, f);
+    number_of_seeds += 1;
+    fclose(f);
+}
+
+
+/* a random number from 0 to n-1 (xorshift) */
+unsigned long long random_state = 88172645463325252ULL;
+
+size_t random_below(size_t n)
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return((n == 0) ? 0 : random_state % n);
+}
+
+/* put n bytes at position at, moving the rest along; as much as fits */
+void insert_bytes(size_t at, const unsigned char *bytes, size_t n)
+{
+    if (input_size + n > MAX_INPUT) n = MAX_INPUT - input_size;
+    memmove(&input[at + n], &input[at], input_size - at);
+    memcpy(&input[at], bytes, n);
+    input_size += n;
+}
+
+/* change the input in a few random ways */
+void mutate(void)
+{
+    int changes = 1 + random_below(4);
+    while (changes-- > 0)
+        {
+            size_t at = random_below(input_size + 1);
+            switch (random_below(7))
+                {
+                case 0: /* flip a bit */
+                    if (at < input_size) input[at] ^= 1 << random_below(8);
+                    break;
+
+                case 1: /* a random byte */
+                    if (at < input_size) input[at] = random_below(256);
+                    break;
+
+                case 2: /* a printable byte, put in */
+                    {
+                        unsigned char c = ' ' + random_below(95);
+                        insert_bytes(at, &c, 1);
+                        break;
+                    }
+
+                case 3: /* cut some out */
+                    if (at < input_size)
+                        {
+                            size_t n = 1 + random_below(input_size - at);
+                            if (n > 16) n = 1 + random_below(16);
+                            memmove(&input[at], &input[at + n], input_size - at - n);
+                            input_size -= n;
+                        }
+                    break;
+
+                case 4: /* a word from the dictionary */
+                    {
+                        int n = 0;
+                        while (target->dictionary[n] != NULL) n++;
+                        const char *w = target->dictionary[random_below(n)];
+                        insert_bytes(at, CAST(const unsigned char *, w), (w[0] == '\0') ? 1 : strlen(w));
+                        break;
+                    }
+
+                case 5: /* copy a piece of the input somewhere else */
+                    if (input_size > 0)
+                        {
+                            unsigned char piece[64];
+                            size_t from = random_below(input_size);
+                            size_t n = 1 + random_below(sizeof(piece));
+                            if (n > input_size - from) n = input_size - from;
+                            memcpy(piece, &input[from], n);
+                            insert_bytes(at, piece, n);
+                        }
+                    break;
+
+                case 6: /* a piece of another seed */
+                    {
+                        int s = random_below(number_of_seeds);
+                        if (seed_sizes[s] > 0)
+                            {
+                                size_t from = random_below(seed_sizes[s]);
+                                size_t n = 1 + random_below(256);
+                                if (n > seed_sizes[s] - from) n = seed_sizes[s] - from;
+                                insert_bytes(at, &seeds[s][from], n);
+                            }
+                        break;
+                    }
+                }
+        }
+}
+
+
+double seconds_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return(t.tv_sec + t.tv_nsec / 1e9);
+}
+
+void usage(void)
+{
+    fprintf(stderr, "usage: fuzz8 [-t tokens|asm|obj8|hex] [-n iterations] [-s seed] seed-file ...\n");
+    exit(1);
+}
+
+int main(int argc, STRING *argv)
+{
+    const char *name = "asm";
+    long iterations = 100000;
+    int i;
+    for (i = 1; i < argc; i++)
+        {
+            if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+                name = argv[++i];
+            else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+                iterations = atol(argv[++i]);
+            else if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc))
+                random_state = strtoull(argv[++i], NULL, 0) | 1;
+            else if (argv[i][0] != '-')
+                read_seed(argv[i]);
+            else
+                usage();
+        }
+    target = find_target(name);
+    if (target == NULL) usage();
+    if (number_of_seeds == 0)
+        read_seed("/dev/null");
+
+    null_file = fopen("/dev/null", "w");
+    signal(SIGSEGV, crashed);
+    signal(SIGBUS, crashed);
+    signal(SIGFPE, crashed);
+    signal(SIGILL, crashed);
+    signal(SIGABRT, crashed);
+    signal(SIGALRM, crashed);
+
+    double start = seconds_now();
+    for (i = 0; i < number_of_seeds; i++)
+        {
+            input_size = seed_sizes[i];
+            memcpy(input, seeds[i], input_size);
+            alarm(MAX_SECONDS);
+            target->run(input, input_size);
+        }
+
+    long n;
+    for (n = 0; n < iterations; n++)
+        {
+            int s = random_below(number_of_seeds);
+            input_size = seed_sizes[s];
+            memcpy(input, seeds[s], input_size);
+            mutate();
+            alarm(MAX_SECONDS);
+            target->run(input, input_size);
+        }
+
+    alarm(0);
+
+    double seconds = seconds_now() - start;
+    printf("fuzz8 %s: %ld inputs in %.1f seconds, %.0f a minute\n", target->name,
+           number_of_seeds + iterations, seconds,
+           (seconds > 0) ? 60 * (number_of_seeds + iterations) / seconds : 0.0);
+    return(0);
+}
+
+#endif
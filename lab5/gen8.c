@@ -0,0 +1,257 @@
+/*
+  gen8 -- write a synthetic PDP-8 assembly language program, for
+  measuring the assembler (see bench8.c).
+
+  The program fills memory from page 1 up, one word per line, with a
+  random mix of memory reference, operate and IOT instructions and
+  data words.  Memory references go to labels on their own page, so
+  no links are needed; some go forward (to a label not yet defined)
+  and the rest backward.
+
+  usage: gen8 [-n words] [-l labels] [-f forward] [-m operate]
+              [-g group2] [-i iot] [-d data] [-c comments] [-s seed]
+
+  -n  words of code (at most 3968, pages 1 to 31; default 3800)
+  -l  labels per word (default 0.25); more than 1 gives words with
+      several labels
+  -f  the fraction of memory references that are forward (0.5)
+  -m  the fraction of words that are operate instructions (0.4)
+  -g  the fraction of operate instructions that are group 2 (0.3)
+  -i  the fraction that are IOT instructions (0.02)
+  -d  the fraction that are data words (0.05)
+  -c  comment lines per word (0.1)
+  -s  the random number seed (1)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef short Boolean;
+#define TRUE 1
+#define FALSE 0
+
+typedef char *STRING;
+
+#define CAST(t,e) ((t)(e))
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+int    number_of_words = 3800;
+double label_density = 0.25;
+double forward_ratio = 0.5;
+double operate_fraction = 0.4;
+double group2_fraction = 0.3;
+double iot_fraction = 0.02;
+double data_fraction = 0.05;
+double comment_density = 0.1;
+unsigned int seed = 1;
+
+#define FIRST_ADDRESS 0x080
+#define MAX_WORDS     (4096 - FIRST_ADDRESS)
+
+/* the labels: label i is at label_address[i], in address order */
+int  number_of_labels = 0;
+int *label_address;
+
+/* the labels of each word: first_label[w] up to first_label[w+1] */
+int *first_label;
+
+
+double random_fraction(void)
+{
+    return(rand() / (RAND_MAX + 1.0));
+}
+
+/* a count that averages to density */
+int random_count(double density)
+{
+    int n = (int)density;
+    if (random_fraction() < density - n) n += 1;
+    return(n);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+const char *memory_reference_opcodes[] = { "AND", "TAD", "ISZ", "DCA", "JMS", "JMP" };
+const char *group1_opcodes[] = { "CLA", "CLL", "CMA", "CML", "IAC" };
+const char *rotate_opcodes[] = { "RAR", "RAL", "RTR", "RTL" };
+const char *skip_or_opcodes[] = { "SMA", "SZA", "SNL" };
+const char *skip_and_opcodes[] = { "SPA", "SNA", "SZL" };
+
+/* a label on the same page as word w, after it (or, not forward,
+   at or before it); -1 if there is none */
+int pick_label(int w, Boolean forward)
+{
+    int addr = FIRST_ADDRESS + w;
+    int page = addr & 0xF80;
+
+    /* the labels from here to the end (or start) of the page */
+    int lo, hi;
+    if (forward)
+        {
+            lo = first_label[w + 1];
+            hi = lo;
+            while ((hi < number_of_labels) && ((label_address[hi] & 0xF80) == page)) hi += 1;
+        }
+    else
+        {
+            hi = first_label[w + 1];
+            lo = hi;
+            while ((lo > 0) && ((label_address[lo - 1] & 0xF80) == page)) lo -= 1;
+        }
+    if (lo == hi) return(-1);
+    return(lo + rand() % (hi - lo));
+}
+
+void write_memory_reference(int w)
+{
+    printf("%s ", memory_reference_opcodes[rand() % 6]);
+    if (random_fraction() < 0.1) printf("I ");
+
+    Boolean forward = random_fraction() < forward_ratio;
+    int label = pick_label(w, forward);
+    if (label < 0) label = pick_label(w, !forward);
+    if (label < 0)
+        printf("0x%02X", 0x10 + rand() % 0x70);
+    else
+        printf("L%d", label);
+}
+
+void write_some(const char **names, int n, Boolean at_least_one)
+{
+    Boolean any = FALSE;
+    int i;
+    for (i = 0; i < n; i++)
+        if (random_fraction() < 0.4)
+            {
+                printf("%s%s", any ? " " : "", names[i]);
+                any = TRUE;
+            }
+    if (!any && at_least_one)
+        printf("%s", names[rand() % n]);
+}
+
+void write_operate(void)
+{
+    if (random_fraction() >= group2_fraction)
+        {
+            write_some(group1_opcodes, 5, TRUE);
+            if (random_fraction() < 0.3)
+                printf(" %s", rotate_opcodes[rand() % 4]);
+            return;
+        }
+
+    int which = rand() % 3;
+    if (which == 0) write_some(skip_or_opcodes, 3, TRUE);
+    else if (which == 1) write_some(skip_and_opcodes, 3, TRUE);
+    else printf("SKP");
+    if (random_fraction() < 0.3) printf(" CLA");
+}
+
+void write_word(int w)
+{
+    int i;
+    for (i = first_label[w]; i < first_label[w + 1]; i++)
+        printf("L%d, ", i);
+
+    double r = random_fraction();
+    if (r < data_fraction)
+        printf("%d", rand() % 4096);
+    else if (r < data_fraction + iot_fraction)
+        printf("IOT %d,0", 3 + rand() % 2);
+    else if (r < data_fraction + iot_fraction + operate_fraction)
+        write_operate();
+    else
+        write_memory_reference(w);
+
+    if (random_fraction() < 0.2) printf("    / word %d", w);
+    printf("\n");
+
+    int n = random_count(comment_density);
+    while (n-- > 0)
+        printf("/ a comment line, to be skipped over by the assembler\n");
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+void usage(void)
+{
+    fprintf(stderr, "usage: gen8 [-n words] [-l labels] [-f forward] [-m operate] [-g group2]\n"
+                    "            [-i iot] [-d data] [-c comments] [-s seed]\n");
+    exit(1);
+}
+
+int main(int argc, STRING *argv)
+{
+    int i;
+    for (i = 1; i < argc; i++)
+        {
+            if ((argv[i][0] != '-') || (strlen(argv[i]) != 2) || (i + 1 >= argc)) usage();
+            char *value = argv[++i];
+            switch (argv[i-1][1])
+                {
+                case 'n': number_of_words = atoi(value); break;
+                case 'l': label_density = atof(value); break;
+                case 'f': forward_ratio = atof(value); break;
+                case 'm': operate_fraction = atof(value); break;
+                case 'g': group2_fraction = atof(value); break;
+                case 'i': iot_fraction = atof(value); break;
+                case 'd': data_fraction = atof(value); break;
+                case 'c': comment_density = atof(value); break;
+                case 's': seed = atoi(value); break;
+                default: usage();
+                }
+        }
+    if ((number_of_words < 1) || (number_of_words > MAX_WORDS))
+        {
+            fprintf(stderr, "gen8: -n must be from 1 to %d\n", MAX_WORDS);
+            exit(1);
+        }
+    srand(seed);
+
+    /* place the labels first, so references can go forward */
+    first_label = CAST(int *, malloc((number_of_words + 1) * sizeof(int)));
+    int max_labels = 1024;
+    label_address = CAST(int *, malloc(max_labels * sizeof(int)));
+    int w;
+    for (w = 0; w < number_of_words; w++)
+        {
+            first_label[w] = number_of_labels;
+            int n = random_count(label_density);
+            while (n-- > 0)
+                {
+                    if (number_of_labels >= max_labels)
+                        {
+                            max_labels = 2*max_labels;
+                            label_address = CAST(int *, realloc(label_address, max_labels * sizeof(int)));
+                        }
+                    label_address[number_of_labels++] = FIRST_ADDRESS + w;
+                }
+        }
+    first_label[number_of_words] = number_of_labels;
+
+    printf("/ synthetic program: gen8 -n %d -l %g -f %g -m %g -g %g -i %g -d %g -c %g -s %u\n",
+           number_of_words, label_density, forward_ratio, operate_fraction, group2_fraction,
+           iot_fraction, data_fraction, comment_density, seed);
+    printf("        ORIG 0x%03X\n", FIRST_ADDRESS);
+    printf("START,  ");
+    for (w = 0; w < number_of_words; w++)
+        write_word(w);
+    printf("        END START\n");
+
+    free(first_label);
+    free(label_address);
+    exit(0);
+}
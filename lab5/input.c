@@ -0,0 +1,32 @@
+/*
+   Assembler for PDP-8.  Reading a whole file into memory.  See input.h.
+*/
+
+#include "asm8.h"
+#include "input.h"
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+char *read_all(FILE *f, long *length)
+{
+    size_t size = 65536;
+    size_t n = 0;
+    char *buffer = CAST(char *, malloc(size));
+    size_t got;
+    while ((got = fread(&buffer[n], 1, size - n - 1, f)) > 0)
+        {
+            n += got;
+            if (n + 1 >= size)
+                {
+                    size = 2*size;
+                    buffer = CAST(char *, realloc(buffer, size));
+                }
+        }
+    buffer[n] = '\0';
+    *length = n;
+    return(buffer);
+}
@@ -0,0 +1,20 @@
+/*
+   Assembler for PDP-8.  Reading a whole file into memory.
+*/
+
+#ifndef _INPUT_H_
+#define _INPUT_H_
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* read_all reads f until EOF, a piece at a time, so it can be a pipe
+   as well as a file.  The buffer is malloc'ed, with room for a null
+   after the last byte, which is put there. */
+
+/* prototypes */
+char *read_all(FILE *f, long *length);
+
+#endif
@@ -0,0 +1,111 @@
+/*
+   Assembler for PDP-8.  Interned names.  See intern.h.
+*/
+
+#include <ctype.h>
+#include "asm8.h"
+#include "arena.h"
+#include "opcode.h"
+#include "symbol.h"
+#include "stats.h"
+#include "intern.h"
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+#define INITIAL_NAMES_SIZE 256      /* a power of 2 */
+
+/* make the table twice as big, moving each name to its new chain */
+void grow_names(Assembly *a)
+{
+    int size = (a->max_names == 0) ? INITIAL_NAMES_SIZE : 2*a->max_names;
+    struct interned_name **names = CAST(struct interned_name **, calloc(size, sizeof(struct interned_name *)));
+    STATS_ALLOCATED(a, size * sizeof(struct interned_name *));
+
+    int i;
+    for (i = 0; i < a->max_names; i++)
+        while (a->names[i] != NULL)
+            {
+                struct interned_name *n = a->names[i];
+                a->names[i] = n->next;
+                n->next = names[n->hash & (size - 1)];
+                names[n->hash & (size - 1)] = n;
+            }
+
+    if (a->names != NULL) free(a->names);
+    a->names = names;
+    a->max_names = size;
+}
+
+/* the interned name for name; name need not be null terminated, and
+   length is the number of characters */
+struct interned_name *intern_name(Assembly *a, const char *name, int length)
+{
+    enum stats_phase saved = STATS_ENTER(a, PHASE_SYMBOLS);
+
+    /* fold and hash it, once (FNV-1a) */
+    unsigned int hash = 2166136261u;
+    int i;
+    for (i = 0; i < length; i++)
+        hash = (hash ^ toupper(name[i])) * 16777619u;
+
+    long probes = 0;
+    struct interned_name *n = NULL;
+    if (a->max_names > 0)
+        for (n = a->names[hash & (a->max_names - 1)]; n != NULL; n = n->next)
+            {
+                probes += 1;
+                if ((n->hash != hash) || (n->length != length)) continue;
+                for (i = 0; i < length; i++)
+                    if (toupper(name[i]) != n->name[i]) break;
+                if (i == length) break;
+            }
+
+    if (n == NULL)
+        {
+            /* a new one */
+            if (a->number_of_names >= a->max_names) grow_names(a);
+            size_t before = a->symbol_space.allocated;
+
+            n = CAST(struct interned_name *, arena_alloc(&a->symbol_space, sizeof(struct interned_name) + length + 1));
+            n->hash = hash;
+            n->length = length;
+            for (i = 0; i < length; i++)
+                n->name[i] = toupper(name[i]);
+            n->name[length] = '\0';
+            n->spelling = arena_strndup(&a->symbol_space, name, length);
+            n->op = search_opcode(name, length);
+            n->sy = NULL;
+            n->uses = NULL;
+            n->number_of_uses = 0;
+            n->max_uses = 0;
+            n->next = a->names[hash & (a->max_names - 1)];
+            a->names[hash & (a->max_names - 1)] = n;
+            a->number_of_names += 1;
+            STATS_ALLOCATED(a, a->symbol_space.allocated - before);
+        }
+
+    if (a->stats != NULL)
+        {
+            a->stats->searches += 1;
+            a->stats->probes += probes;
+            if (probes > a->stats->longest_search) a->stats->longest_search = probes;
+        }
+    STATS_LEAVE(a, saved);
+    return(n);
+}
+
+
+/* free the table; the names in it are in a->symbol_space, and are
+   freed with the symbols (by Release_Symbol_Table, which calls this) */
+void Release_Names(Assembly *a)
+{
+    if (a->names != NULL)
+        free(a->names);
+    a->names = NULL;
+    a->number_of_names = 0;
+    a->max_names = 0;
+}
@@ -0,0 +1,50 @@
+/*
+   Assembler for PDP-8.  Interned names.
+*/
+
+#ifndef _INTERN_H_
+#define _INTERN_H_
+
+#include "asm8.h"
+#include "opcode.h"
+#include "symbol.h"
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* Each different identifier in the source is kept once, folded to
+   upper case, with its hash and length, in a hash table (a->names)
+   that grows as needed.  get_token interns every identifier it
+   reads, so the case is folded and the name hashed once per token;
+   after that, a name is its pointer.  The opcode with the name (if
+   any) is found when it is first interned, and the symbol with the
+   name is kept with it, so neither needs to be searched for again. */
+
+/* a line a name is on, for -X (xref.c) */
+struct name_use
+{
+    int file_number;            /* as a->file_number */
+    int line_number;
+};
+
+struct interned_name
+{
+    struct interned_name *next; /* in its hash chain */
+    unsigned int hash;
+    int          length;
+    const opcode *op;           /* the opcode with this name, or NULL */
+    symbol      *sy;            /* the symbol with this name, or NULL */
+    char        *spelling;      /* as it was first written */
+    struct name_use *uses;      /* lines it is on, for -X (xref.c) */
+    int          number_of_uses;
+    int          max_uses;
+    char         name[];        /* folded to upper case */
+};
+
+/* prototypes */
+struct interned_name *intern_name(Assembly *a, const char *name, int length);
+void Release_Names(Assembly *a);
+
+#endif
@@ -0,0 +1,155 @@
+/*
+   Assembler for PDP-8.  The assembler as a library.  See libasm8.h.
+*/
+
+#define _GNU_SOURCE             /* for fopencookie */
+#include "asm8.h"
+#include "symbol.h"
+#include "objmem.h"
+#include "optimize.h"
+#include "libasm8.h"
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* The assembly writes its error messages to a->errors, as it always
+   has.  Here that is a stream that turns each line written to it
+   into a diagnostic, with the line the error is at (a->error_line,
+   set by Report_Error) when the message was started. */
+
+struct diagnostic_stream
+{
+    Assembly *a;
+    struct asm8_image *image;
+    char   *text;               /* the message so far */
+    size_t  length;
+    size_t  max_length;
+    int     line;               /* of the error */
+};
+
+void add_diagnostic(struct diagnostic_stream *d)
+{
+    struct asm8_image *image = d->image;
+    if (image->number_of_diagnostics >= image->max_diagnostics)
+        {
+            image->max_diagnostics = (image->max_diagnostics == 0) ? 16 : 2*image->max_diagnostics;
+            image->diagnostics = CAST(struct asm8_diagnostic *,
+                                      realloc(image->diagnostics, image->max_diagnostics * sizeof(struct asm8_diagnostic)));
+        }
+    struct asm8_diagnostic *g = &image->diagnostics[image->number_of_diagnostics++];
+    g->message = CAST(char *, malloc(d->length + 1));
+    memcpy(g->message, d->text, d->length);
+    g->message[d->length] = '\0';
+    g->line = d->line;
+    d->length = 0;
+}
+
+ssize_t write_diagnostics(void *cookie, const char *buffer, size_t size)
+{
+    struct diagnostic_stream *d = CAST(struct diagnostic_stream *, cookie);
+    size_t i;
+    for (i = 0; i < size; i++)
+        {
+            if (buffer[i] == '\n')
+                {
+                    add_diagnostic(d);
+                    continue;
+                }
+            if (d->length == 0) d->line = d->a->error_line;
+            if (d->length + 1 >= d->max_length)
+                {
+                    d->max_length = (d->max_length == 0) ? 128 : 2*d->max_length;
+                    d->text = CAST(char *, realloc(d->text, d->max_length));
+                }
+            d->text[d->length++] = buffer[i];
+        }
+    return(size);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* assemble the length characters of source into image; returns the
+   number of errors.  The image is cleared first; free what it holds
+   with Free_Image. */
+
+int Assemble_Buffer(const char *source, long length, const struct asm8_options *options, struct asm8_image *image)
+{
+    memset(image, 0, sizeof(struct asm8_image));
+
+    struct diagnostic_stream d;
+    memset(&d, 0, sizeof(d));
+    d.image = image;
+    cookie_io_functions_t functions = { NULL, write_diagnostics, NULL, NULL };
+    FILE *errors = fopencookie(&d, "w", functions);
+    setvbuf(errors, NULL, _IONBF, 0);
+
+    FILE *listing_file = NULL;
+    if ((options != NULL) && options->listing)
+        listing_file = open_memstream(&image->listing, &image->listing_size);
+
+    /* the assembly is too big to put on a thread's stack */
+    Assembly *a = TYPED_MALLOC(Assembly);
+    Initialize_Assembly(a, NULL, NULL, listing_file, errors);
+    d.a = a;
+    a->listing = (listing_file != NULL);
+    a->listing_to_terminal = FALSE;
+    a->optimize = (options != NULL) && options->optimize;
+    a->file_name = (options != NULL) ? options->file_name : NULL;
+
+    /* the assembly frees the buffer it reads */
+    a->file_buffer = CAST(char *, malloc(length + 1));
+    memcpy(a->file_buffer, source, length);
+    a->file_buffer[length] = '\0';
+    a->file_length = length;
+
+    Clear_Object_Code(a);
+    Assemble_File(a);
+    Check_for_undefined_symbols(a);
+    if ((a->number_of_errors == 0) && a->optimize)
+        {
+            struct optimize_stats stats;
+            Optimize_Object_Code(a, &stats);
+        }
+
+    memcpy(image->memory, a->memory, sizeof(image->memory));
+    memcpy(image->defined_bits, a->defined_bits, sizeof(image->defined_bits));
+    image->entry_point = a->entry_point & 0xFFF;
+    image->number_of_errors = a->number_of_errors;
+
+    Release_Assembly(a);
+    free(a);
+    fclose(errors);
+    if (d.length > 0) add_diagnostic(&d);
+    if (d.text != NULL) free(d.text);
+    if (listing_file != NULL) fclose(listing_file);
+
+    return(image->number_of_errors);
+}
+
+/* did the assembly put something at addr? */
+Boolean Image_Defined(const struct asm8_image *image, Address addr)
+{
+    addr = addr & 0xFFF;
+    return((image->defined_bits[addr / 64] >> (addr % 64)) & 1);
+}
+
+void Free_Image(struct asm8_image *image)
+{
+    int i;
+    for (i = 0; i < image->number_of_diagnostics; i++)
+        free(image->diagnostics[i].message);
+    if (image->diagnostics != NULL) free(image->diagnostics);
+    image->diagnostics = NULL;
+    image->number_of_diagnostics = 0;
+    image->max_diagnostics = 0;
+    if (image->listing != NULL) free(image->listing);
+    image->listing = NULL;
+    image->listing_size = 0;
+}
@@ -0,0 +1,57 @@
+/*
+   Assembler for PDP-8.  The assembler as a library (libasm8.a).
+*/
+
+#ifndef _LIBASM8_H_
+#define _LIBASM8_H_
+
+#include "asm8.h"
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* Assemble_Buffer assembles source held in memory into a memory
+   image: no files are read (except INCLUDEs) or written, and nothing
+   is printed.  Each error message is returned as a diagnostic, with
+   the line it is at (which may be long before the line being
+   assembled when it was found), or 0 if it is not at any one line.
+
+   Nothing is shared between two calls, so they can be made from
+   several threads at once. */
+
+struct asm8_options
+{
+    Boolean optimize;           /* as -O */
+    Boolean listing;            /* keep the listing in the image */
+    STRING  file_name;          /* for finding INCLUDEs; may be NULL */
+};
+
+struct asm8_diagnostic
+{
+    int   line;
+    char *message;              /* without the newline */
+};
+
+struct asm8_image
+{
+    INST     memory[4096];
+    unsigned long long defined_bits[4096 / 64];   /* a bit per word */
+    Address  entry_point;
+    int      number_of_errors;
+
+    struct asm8_diagnostic *diagnostics;
+    int      number_of_diagnostics;
+    int      max_diagnostics;
+
+    char    *listing;           /* if options->listing */
+    size_t   listing_size;
+};
+
+/* prototypes */
+int Assemble_Buffer(const char *source, long length, const struct asm8_options *options, struct asm8_image *image);
+Boolean Image_Defined(const struct asm8_image *image, Address addr);
+void Free_Image(struct asm8_image *image);
+
+#endif
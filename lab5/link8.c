@@ -0,0 +1,292 @@
+/*
+  PDP-8 Linker:
+
+  input is a list of relocatable modules (.rel, from asm8 -r).
+  Output is one OBJ8 object file, as asm8 would write for the whole
+  program.
+
+  Page zero of every module is loaded where it was assembled; it is
+  shared, and two modules may not both use the same word of it.  All
+  other pages are loaded one after another, from page 1 up, in the
+  order the modules were named (and, within a module, in page order).
+  A page moves as a whole, so references within a page need no change;
+  the linker fixes the words that hold addresses (R), and the uses of
+  EXTERN symbols (U), from the GLOBAL symbols of the other modules.
+*/
+
+#include "asm8.h"
+#include "objmem.h"
+#include "reloc.h"
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+struct module *modules = NULL;
+int number_of_modules = 0;
+
+/* where an address of module m ends up */
+Address relocate(struct module *m, Address addr)
+{
+    return(m->page_map[addr / PAGE_SIZE] * PAGE_SIZE + (addr % PAGE_SIZE));
+}
+
+/* ***************************************************************** */
+
+/* Lay out the pages.  A page of a module is used if it has code, or
+   any of its addresses is used (a symbol that labels the end of a
+   page, for example). */
+
+void place_pages(Assembly *a)
+{
+    int next_page = 1;
+    int i;
+    for (i = 0; i < number_of_modules; i++)
+        {
+            struct module *m = &modules[i];
+            Boolean used[NUMBER_OF_PAGES];
+            memset(used, 0, sizeof(used));
+
+            int addr;
+            for (addr = PAGE_SIZE; addr < 4096; addr++)
+                {
+                    if (m->defined[addr]) used[addr / PAGE_SIZE] = TRUE;
+                    if (m->relocate[addr] && m->defined[addr])
+                        used[m->memory[addr] / PAGE_SIZE] = TRUE;
+                }
+            int k;
+            for (k = 0; k < m->number_of_globals; k++)
+                if (m->globals[k].relocatable) used[m->globals[k].value / PAGE_SIZE] = TRUE;
+            if (m->has_entry && m->entry_relocatable)
+                used[m->entry / PAGE_SIZE] = TRUE;
+
+            int page;
+            m->page_map[0] = 0;
+            for (page = 1; page < NUMBER_OF_PAGES; page++)
+                {
+                    if (!used[page]) continue;
+                    if (next_page >= NUMBER_OF_PAGES)
+                        {
+                            a->number_of_errors += 1;
+                            fprintf(a->errors, "%s: out of memory; no room for page %d\n", m->name, page);
+                            next_page = 1;
+                        }
+                    m->page_map[page] = next_page;
+                    next_page += 1;
+                }
+        }
+}
+
+
+/* ***************************************************************** */
+
+/* the GLOBAL symbols of all the modules, once relocated */
+
+struct link_symbol
+{
+    char   *name;
+    Address value;
+    struct module *defined_in;
+};
+
+struct link_symbol *link_symbols = NULL;
+int number_of_link_symbols = 0;
+
+int compare_link_symbols(const void *p, const void *q)
+{
+    const struct link_symbol *x = CAST(const struct link_symbol *, p);
+    const struct link_symbol *y = CAST(const struct link_symbol *, q);
+    return(strcasecmp(x->name, y->name));
+}
+
+void collect_globals(Assembly *a)
+{
+    int n = 0;
+    int i, k;
+    for (i = 0; i < number_of_modules; i++)
+        n += modules[i].number_of_globals;
+    link_symbols = CAST(struct link_symbol *, malloc((n + 1) * sizeof(struct link_symbol)));
+
+    for (i = 0; i < number_of_modules; i++)
+        {
+            struct module *m = &modules[i];
+            for (k = 0; k < m->number_of_globals; k++)
+                {
+                    struct link_symbol *l = &link_symbols[number_of_link_symbols++];
+                    l->name = m->globals[k].name;
+                    l->value = m->globals[k].relocatable ? relocate(m, m->globals[k].value) : m->globals[k].value;
+                    l->defined_in = m;
+                }
+        }
+
+    /* sort them, to find duplicates now and to search them later */
+    if (number_of_link_symbols > 1)
+        qsort(link_symbols, number_of_link_symbols, sizeof(struct link_symbol), compare_link_symbols);
+    for (i = 1; i < number_of_link_symbols; i++)
+        {
+            if (strcasecmp(link_symbols[i-1].name, link_symbols[i].name) == 0)
+                {
+                    a->number_of_errors += 1;
+                    fprintf(a->errors, "symbol %s is GLOBAL in both %s and %s\n", link_symbols[i].name,
+                            link_symbols[i-1].defined_in->name, link_symbols[i].defined_in->name);
+                }
+        }
+}
+
+struct link_symbol *search_link_symbol(const char *name)
+{
+    struct link_symbol key;
+    key.name = CAST(char *, name);
+    return(CAST(struct link_symbol *, bsearch(&key, link_symbols, number_of_link_symbols,
+                                              sizeof(struct link_symbol), compare_link_symbols)));
+}
+
+
+/* ***************************************************************** */
+
+/* put each module's code in its place, and fix it up */
+
+void load_modules(Assembly *a)
+{
+    int i, k;
+    for (i = 0; i < number_of_modules; i++)
+        {
+            struct module *m = &modules[i];
+
+            int addr;
+            for (addr = 0; addr < 4096; addr++)
+                {
+                    if (!m->defined[addr]) continue;
+                    INST inst = m->memory[addr];
+                    if (m->relocate[addr])
+                        inst = relocate(m, inst);
+
+                    /* only page zero can be shared */
+                    Address at = relocate(m, addr);
+                    if (Is_Defined(a, at))
+                        {
+                            a->number_of_errors += 1;
+                            fprintf(a->errors, "%s: page zero word 0x%03X is already used by another module\n",
+                                    m->name, at);
+                            continue;
+                        }
+                    Define_Object_Code(a, at, inst, FALSE);
+                }
+
+            for (k = 0; k < m->number_of_uses; k++)
+                {
+                    struct rel_use *u = &m->uses[k];
+                    const char *name = m->externals[u->number];
+                    struct link_symbol *l = search_link_symbol(name);
+                    if (l == NULL)
+                        {
+                            a->number_of_errors += 1;
+                            fprintf(a->errors, "%s: undefined symbol %s\n", m->name, name);
+                            continue;
+                        }
+
+                    Address at = relocate(m, u->addr);
+                    if (u->how == 'F')
+                        Define_Object_Code(a, at, l->value, TRUE);
+                    else if ((l->value & 0xF80) != 0)
+                        {
+                            /* no other module's page is this one */
+                            a->number_of_errors += 1;
+                            fprintf(a->errors, "%s: %s is used through page zero at 0x%03X, but is not on page zero\n",
+                                    m->name, name, at);
+                        }
+                    else
+                        Define_Object_Code(a, at, Adjust_for_ZC(a, at, Fetch_Object_Code(a, at), l->value, 0), TRUE);
+                }
+
+            if (m->has_entry && !a->entry_given)
+                {
+                    a->entry_given = TRUE;
+                    a->entry_point = m->entry_relocatable ? relocate(m, m->entry) : m->entry;
+                }
+        }
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+void usage(void)
+{
+    fprintf (stderr,"usage: link8 [-o output] module.rel ...\n");
+    exit(1);
+}
+
+int main(int argc, STRING *argv)
+{
+    STRING output_name = NULL;
+    int i;
+
+    modules = CAST(struct module *, malloc(argc * sizeof(struct module)));
+    for (i = 1; i < argc; i++)
+        {
+            if (strcmp(argv[i], "-o") == 0)
+                {
+                    if (++i >= argc) usage();
+                    output_name = argv[i];
+                }
+            else if (argv[i][0] == '-')
+                {
+                    fprintf (stderr,"link8: Bad option %s\n", argv[i]);
+                    usage();
+                }
+            else
+                {
+                    if (!Read_Module(argv[i], &modules[number_of_modules], stderr))
+                        exit(1);
+                    number_of_modules += 1;
+                }
+        }
+    if (number_of_modules == 0) usage();
+
+    /* the linked program is built in an Assembly, so it can be
+       written out just as asm8 does */
+    Assembly *a = CAST(Assembly *, malloc(sizeof(Assembly)));
+    memset(a, 0, sizeof(Assembly));
+    a->errors = stderr;
+    Clear_Object_Code(a);
+
+    place_pages(a);
+    collect_globals(a);
+    load_modules(a);
+
+    if (a->number_of_errors > 0)
+        {
+            fprintf(stderr, "*** %d errors in link\n", a->number_of_errors);
+            exit(1);
+        }
+
+    /* by default, named for the first module */
+    if (output_name == NULL)
+        {
+            STRING first = modules[0].name;
+            output_name = CAST(STRING, malloc(strlen(first) + 5));
+            strcpy(output_name, first);
+            char *dot = strrchr(output_name, '.');
+            if ((dot != NULL) && (strcmp(dot, ".rel") == 0)) *dot = '\0';
+            strcat(output_name, ".out");
+        }
+    a->output = fopen(output_name, "w");
+    if (a->output == NULL)
+        {
+            fprintf (stderr, "Can't open %s\n", output_name);
+            exit(1);
+        }
+    Output_Object_Code(a);
+    fclose(a->output);
+
+    for (i = 0; i < number_of_modules; i++)
+        Free_Module(&modules[i]);
+    free(modules);
+    free(link_symbols);
+    free(a);
+    exit(0);
+}
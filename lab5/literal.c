@@ -0,0 +1,200 @@
+/*
+   Assembler for PDP-8.  Current-page literals and links.
+
+   A memory reference can only reach page zero and its own page.  So
+   constants (TAD (5)) and the addresses of things on other pages
+   (JMP FAR) are put in words on the same page as the instruction,
+   which then refers to that word -- indirectly, for an address.
+   This is the literal pool of the page.
+
+   As PAL-8 does, each page's pool starts at the last word of the page
+   and grows down, toward the code growing up; the same value is only
+   put in a page's pool once.  Since a value may be a symbol not yet
+   defined, the pools are laid out at the end of the assembly, after
+   the forward references are resolved.
+*/
+
+#include "asm8.h"
+#include "error.h"
+#include "symbol.h"
+#include "objmem.h"
+#include "reloc.h"
+#include "literal.h"
+#include "expr.h"
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+void literal_reference(Assembly *a, Address addr, symbol *sy, const struct expression *e, int value, Boolean link,
+                       int line_number)
+{
+    if (a->debug) fprintf(a->errors, "%s for %s at address 0x%03X\n",
+                       (link ? "link" : "literal"), (sy != NULL ? sy->name : "constant"), addr);
+
+    if (a->number_of_literals >= a->max_literals)
+        {
+            a->max_literals = (a->max_literals == 0) ? 64 : 2*a->max_literals;
+            a->literals = CAST(struct literal_ref *, realloc(a->literals, a->max_literals * sizeof(struct literal_ref)));
+        }
+
+    struct literal_ref *l = &a->literals[a->number_of_literals];
+    l->addr = addr;
+    l->sy = sy;
+    l->expression = e;
+    l->value = value;
+    l->link = link;
+    l->line_number = line_number;
+    l->order = a->number_of_literals;
+    a->number_of_literals += 1;
+}
+
+
+/* A memory reference to addr (which is sy, if it is a symbol).  If it
+   is not on page zero or this page, refer to it through a link on
+   this page instead -- unless the instruction is already indirect. */
+
+INST memory_reference(Assembly *a, Address pc, INST instruction, symbol *sy, const struct expression *e, Address addr,
+                      int line_number)
+{
+    Address addr_page = (addr & 0xF80);
+    if ((addr_page != 0) && (addr_page != (pc & 0xF80)) && ((instruction & 0x100) == 0))
+        {
+            literal_reference(a, pc, sy, e, addr, TRUE, line_number);
+            return(instruction | 0x100);
+        }
+    return(Adjust_for_ZC(a, pc, instruction, addr, line_number));
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* by page, and in the order they were made within a page */
+int compare_literals(const void *p, const void *q)
+{
+    const struct literal_ref *x = CAST(const struct literal_ref *, p);
+    const struct literal_ref *y = CAST(const struct literal_ref *, q);
+    int d = (x->addr & 0xF80) - (y->addr & 0xF80);
+    if (d != 0) return(d);
+    return(x->order - y->order);
+}
+
+/* one word of a pool.  In a relocatable module, an address in the
+   module is not the same as a constant with the same bits, and an
+   EXTERN symbol has no value yet, so each is its own kind. */
+struct pool_word
+{
+    Address slot;
+    int     value;
+    int     kind;
+    symbol *sy;
+};
+
+#define POOL_ABSOLUTE    0
+#define POOL_RELOCATABLE 1
+#define POOL_EXTERNAL    2
+
+void Place_Literals(Assembly *a)
+{
+    if (a->number_of_literals > 1)
+        qsort(a->literals, a->number_of_literals, sizeof(struct literal_ref), compare_literals);
+
+    struct pool_word pool[128];
+    int pool_size = 0;
+    Address page = -1;
+    Address next = 0;
+
+    int i;
+    for (i = 0; i < a->number_of_literals; i++)
+        {
+            struct literal_ref *l = &a->literals[i];
+            symbol *sy = l->sy;
+
+            /* a new page, with an empty pool */
+            if ((l->addr & 0xF80) != page)
+                {
+                    page = l->addr & 0xF80;
+                    next = page + 0x7F;
+                    pool_size = 0;
+                }
+
+            /* undefined symbols are reported later */
+            if ((sy != NULL) && !sy->defined && !sy->external) continue;
+            if ((l->expression != NULL) && (Undefined_In_Expression(l->expression) != NULL)) continue;
+
+            struct pool_word w;
+            w.sy = NULL;
+            w.value = ((sy != NULL) ? sy->value : l->value) & 0xFFF;
+            w.kind = POOL_ABSOLUTE;
+            if ((sy != NULL) && sy->external)
+                {
+                    w.kind = POOL_EXTERNAL;
+                    w.value = 0;
+                    w.sy = sy;
+                }
+            else if ((sy != NULL) && a->relocatable && relocatable_address(w.value))
+                w.kind = POOL_RELOCATABLE;
+            else if (l->expression != NULL)
+                {
+                    int relocation;
+                    w.value = Evaluate_Expression(a, l->expression, &relocation, l->line_number) & 0xFFF;
+                    if (relocation == 1)
+                        w.kind = POOL_RELOCATABLE;
+                    else if ((relocation != 0) && !l->link)
+                        {
+                            Report_Error(a, l->line_number, "Literal can not be relocated");
+                        }
+                }
+
+            /* is it already in the pool? */
+            int k;
+            for (k = 0; k < pool_size; k++)
+                if ((pool[k].value == w.value) && (pool[k].kind == w.kind) && (pool[k].sy == w.sy))
+                    break;
+
+            if (k == pool_size)
+                {
+                    if ((next < page) || Is_Defined(a, next))
+                        {
+                            Report_Error(a, l->line_number, "No room for literals on page 0x%03X", page);
+                            continue;
+                        }
+                    w.slot = next;
+                    next -= 1;
+                    pool[pool_size++] = w;
+                    Define_Object_Code(a, w.slot, w.value, FALSE);
+                    a->word_kind[w.slot] = (sy != NULL) ? WORD_ADDRESS : WORD_DATA;
+
+                    /* the linker may need to change it */
+                    if (a->relocatable && (sy != NULL))
+                        add_fixup(a, sy, w.slot, TRUE, l->line_number);
+                    else if (w.kind == POOL_RELOCATABLE)
+                        {
+                            add_expression_fixup(a, l->expression, w.slot, TRUE, l->line_number);
+                            a->fixups[a->number_of_fixups - 1].relocate = TRUE;
+                        }
+                }
+
+            /* and point the instruction at it, on this page */
+            INST inst = Fetch_Object_Code(a, l->addr);
+            inst = (inst & ~0x0FF) | 0x080 | (pool[k].slot & 0x07F);
+            if (l->link) inst = inst | 0x100;
+            Define_Object_Code(a, l->addr, inst, TRUE);
+        }
+
+    a->number_of_literals = 0;
+}
+
+void Release_Literals(Assembly *a)
+{
+    if (a->literals != NULL)
+        free(a->literals);
+    a->literals = NULL;
+    a->number_of_literals = 0;
+    a->max_literals = 0;
+}
@@ -0,0 +1,38 @@
+/*
+   Assembler for PDP-8.  Current-page literals and links.
+*/
+
+#ifndef _LITERAL_H_
+#define _LITERAL_H_
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* A memory reference instruction whose operand is to be put in a word
+   on its own page: a literal, TAD (5), or a link to an address on
+   another page, which the instruction then uses indirectly.  The
+   words are found (and the instructions finished) once all symbols
+   are known; see Place_Literals. */
+
+struct literal_ref
+{
+    Address addr;               /* of the instruction */
+    symbol *sy;                 /* the value, if it is a symbol */
+    const struct expression *expression;   /* or an expression (expr.h) */
+    int     value;              /* otherwise */
+    Boolean link;               /* make the instruction indirect */
+    int     line_number;
+    int     order;              /* the order they were made in */
+};
+
+/* prototypes */
+void literal_reference(Assembly *a, Address addr, symbol *sy, const struct expression *e, int value, Boolean link,
+                       int line_number);
+INST memory_reference(Assembly *a, Address pc, INST instruction, symbol *sy, const struct expression *e, Address addr,
+                      int line_number);
+void Place_Literals(Assembly *a);
+void Release_Literals(Assembly *a);
+
+#endif
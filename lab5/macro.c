@@ -0,0 +1,833 @@
+/*
+   Assembler for PDP-8.  The preprocessor: INCLUDE, MACRO and REPT.
+
+   The assembler asks for each line with get_next_line.  We read it
+   from the source file (read_source_line), an included file, or the
+   expansion of a macro or REPT, and look at its first word:
+
+      INCLUDE file           the lines of file go here.  The name may
+                             be in quotes; a relative name is relative
+                             to the file doing the including.
+
+      MACRO name p1, p2, ... the lines up to the matching ENDM are the
+      ...                    body of macro name.
+      ENDM
+
+      name a1, a2, ...       expand macro name: its body, with each
+                             parameter replaced by its argument.
+
+      REPT n                 the lines up to the matching ENDM, n times.
+      ...
+      ENDM
+
+   The line with the directive (and the lines of a definition) still
+   go to the assembler to be listed, but cut off before the directive,
+   so that the assembler sees nothing but any labels in front of it.
+   Expanded lines are listed with the line number of the line that
+   caused them.
+
+   Lines are handed on one at a time, as they are needed; nothing is
+   expanded ahead of the assembler.
+*/
+
+#include <ctype.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "asm8.h"
+#include "error.h"
+#include "input.h"
+#include "token.h"
+#include "cache.h"
+#include "macro.h"
+#include "stats.h"
+
+/* how deeply includes and expansions may nest */
+#define MAX_FRAME_DEPTH 64
+
+/* how many lines all the expansions of an assembly may make; nested
+   REPTs (or a macro that calls itself twice) could otherwise run for
+   as good as ever */
+#define MAX_EXPANDED_LINES (1L << 18)
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* scanning the words of a line */
+
+Boolean is_symbol_char(char c)
+{
+    return(isalnum(c) || (c == '_') || (c == '.'));
+}
+
+char *skip_spaces(char *p)
+{
+    while ((*p != '\0') && isspace(*p)) p++;
+    return(p);
+}
+
+char *end_of_symbol(char *p)
+{
+    while (is_symbol_char(*p)) p++;
+    return(p);
+}
+
+Boolean is_word(char *word, int length, const char *name)
+{
+    return((length == strlen(name)) && (strncasecmp(word, name, length) == 0));
+}
+
+/* the end of the operands: the start of a comment, or the end of the line */
+char *end_of_operands(char *p)
+{
+    while ((*p != '\0') && (*p != '/'))
+        {
+            /* a character constant may be a '/' */
+            if ((*p == '\'') && (p[1] != '\0') && (p[2] == '\''))
+                p += 2;
+            p++;
+        }
+    return(p);
+}
+
+/* the first word on the line after any labels, or NULL */
+char *first_word(char *line, int *length)
+{
+    char *p = skip_spaces(line);
+    while (isalpha(*p))
+        {
+            char *q = end_of_symbol(p);
+            char *r = skip_spaces(q);
+            if (*r != ',')
+                {
+                    *length = q - p;
+                    return(p);
+                }
+            p = skip_spaces(r+1);
+        }
+    return(NULL);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* The macro table: a small hash table, since every line's first word
+   has to be looked up in it. */
+
+int macro_hash(const char *name, int length)
+{
+    unsigned int h = 0;
+    while (length-- > 0)
+        h = 31*h + toupper(*name++);
+    return(h % MACRO_TABLE_SIZE);
+}
+
+struct macro *search_macro(Assembly *a, const char *name, int length)
+{
+    struct macro *m;
+    for (m = a->macros[macro_hash(name, length)]; m != NULL; m = m->next)
+        {
+            if ((strncasecmp(name, m->name, length) == 0) && (m->name[length] == '\0'))
+                return(m);
+        }
+    return(NULL);
+}
+
+/* the parameter with this name, or -1 */
+int search_parameter(struct macro *m, const char *name, int length)
+{
+    int i;
+    for (i = 0; i < m->number_of_parameters; i++)
+        {
+            if ((strncasecmp(name, m->parameters[i], length) == 0)
+                && (m->parameters[i][length] == '\0'))
+                return(i);
+        }
+    return(-1);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* Included files are kept in an include cache (macro.h), which may
+   be shared between assemblies on different threads. */
+
+struct include_cache *New_Include_Cache(void)
+{
+    struct include_cache *c = TYPED_MALLOC(struct include_cache);
+    c->files = NULL;
+    pthread_mutex_init(&c->lock, NULL);
+    return(c);
+}
+
+void Free_Include_Cache(struct include_cache *c)
+{
+    while (c->files != NULL)
+        {
+            struct include_file *file = c->files;
+            c->files = file->next;
+            free(file->name);
+            free(file->text);
+            free(file->lines);
+            free(file);
+        }
+    pthread_mutex_destroy(&c->lock);
+    free(c);
+}
+
+struct include_file *read_include_file(const char *name)
+{
+    FILE *f = fopen(name, "r");
+    if (f == NULL) return(NULL);
+
+    /* not a pipe or a device, which may never end */
+    struct stat st;
+    if ((fstat(fileno(f), &st) != 0) || !S_ISREG(st.st_mode))
+        {
+            fclose(f);
+            return(NULL);
+        }
+
+    long n;
+    char *text = read_all(f, &n);
+    fclose(f);
+
+    struct include_file *file = TYPED_MALLOC(struct include_file);
+    file->name = strdup(name);
+    file->hash = hash_bytes(start_cache_key(), text, n);
+    file->text = text;
+
+    /* split it into lines, in place; unlike the source file, a last
+       line without a newline is still a line */
+    int lines = 0;
+    char *p;
+    for (p = text; p < &text[n]; p++)
+        if (*p == '\n') lines += 1;
+    if ((n > 0) && (text[n-1] != '\n')) lines += 1;
+
+    file->number_of_lines = lines;
+    file->lines = CAST(char **, malloc((lines + 1) * sizeof(char *)));
+    int i = 0;
+    p = text;
+    while (p < &text[n])
+        {
+            file->lines[i++] = p;
+            char *nl = CAST(char *, memchr(p, '\n', &text[n] - p));
+            if (nl == NULL) break;
+            *nl = '\0';
+            p = nl + 1;
+        }
+    return(file);
+}
+
+struct include_file *find_include_file(struct include_cache *c, const char *name)
+{
+    pthread_mutex_lock(&c->lock);
+    struct include_file *file;
+    for (file = c->files; file != NULL; file = file->next)
+        {
+            if (strcmp(file->name, name) == 0)
+                break;
+        }
+    if (file == NULL)
+        {
+            file = read_include_file(name);
+            if (file != NULL)
+                {
+                    file->next = c->files;
+                    c->files = file;
+                }
+        }
+    pthread_mutex_unlock(&c->lock);
+    return(file);
+}
+
+/* how much of file_name is its directory (with the last /), which
+   the files it includes are relative to */
+int Include_Directory_Length(const char *file_name)
+{
+    const char *slash = (file_name != NULL) ? strrchr(file_name, '/') : NULL;
+    if (slash == NULL) return(0);
+    return(slash - file_name + 1);
+}
+
+/* the name of the file to include, relative to the file including it */
+char *include_file_name(Assembly *a, const char *name, int length)
+{
+    const char *including = a->file_name;
+    struct source_frame *f;
+    for (f = a->frames; f != NULL; f = f->outer)
+        {
+            if (f->kind == Finclude)
+                {
+                    including = f->file->name;
+                    break;
+                }
+        }
+
+    int directory_length = (name[0] != '/') ? Include_Directory_Length(including) : 0;
+
+    char *path = CAST(char *, malloc(directory_length + length + 1));
+    if (directory_length > 0) memcpy(path, including, directory_length);
+    memcpy(&path[directory_length], name, length);
+    path[directory_length + length] = '\0';
+    return(path);
+}
+
+/* remember that this assembly used file (for the cache, and to
+   number it) */
+struct include_use *note_include_use(Assembly *a, struct include_file *file)
+{
+    struct include_use *u;
+    for (u = a->includes; u != NULL; u = u->next)
+        {
+            if (u->file == file) return(u);
+        }
+    u = CAST(struct include_use *, arena_alloc(&a->macro_space, sizeof(struct include_use)));
+    u->file = file;
+    u->number = (a->includes == NULL) ? 1 : a->includes->number + 1;
+    u->next = a->includes;
+    a->includes = u;
+    return(u);
+}
+
+/* the name of the file with this number (a->file_number), or NULL
+   for the source file */
+const char *Include_File_Name(Assembly *a, int file_number)
+{
+    struct include_use *u;
+    for (u = a->includes; u != NULL; u = u->next)
+        {
+            if (u->number == file_number) return(u->file->name);
+        }
+    return(NULL);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+Boolean push_frame(Assembly *a, struct source_frame *f)
+{
+    if (a->frame_depth >= MAX_FRAME_DEPTH)
+        {
+            Report_Error(a, a->line_number, "INCLUDE, MACRO or REPT nested too deeply");
+            return(FALSE);
+        }
+
+    struct source_frame *g = TYPED_MALLOC(struct source_frame);
+    *g = *f;
+    /* the lines of a MACRO or REPT are numbered as the line that
+       expanded it */
+    if (g->kind != Finclude)
+        g->file_number = a->file_number;
+    g->outer = a->frames;
+    a->frames = g;
+    a->frame_depth += 1;
+    return(TRUE);
+}
+
+void pop_frame(Assembly *a)
+{
+    struct source_frame *f = a->frames;
+    a->frames = f->outer;
+    a->frame_depth -= 1;
+
+    int i;
+    for (i = 0; i < f->number_of_arguments; i++)
+        free(f->arguments[i]);
+    if (f->arguments != NULL) free(f->arguments);
+    if (f->expansion != NULL) free(f->expansion);
+    free(f);
+}
+
+/* add n characters to the expansion of a macro line */
+void expand(struct source_frame *f, int *length, const char *s, int n)
+{
+    if (*length + n + 1 > f->expansion_size)
+        {
+            while (*length + n + 1 > f->expansion_size)
+                f->expansion_size = (f->expansion_size == 0) ? 256 : 2*f->expansion_size;
+            f->expansion = CAST(char *, realloc(f->expansion, f->expansion_size));
+        }
+    memcpy(&f->expansion[*length], s, n);
+    *length += n;
+    f->expansion[*length] = '\0';
+}
+
+/* the line with each parameter replaced by its argument */
+char *substitute_arguments(struct source_frame *f, char *line)
+{
+    int length = 0;
+    expand(f, &length, "", 0);
+
+    char *p = line;
+    while (*p != '\0')
+        {
+            if ((*p == '\'') && (p[1] != '\0') && (p[2] == '\''))
+                {
+                    /* a character constant is never a parameter */
+                    expand(f, &length, p, 3);
+                    p += 3;
+                }
+            else if (isalpha(*p))
+                {
+                    char *q = end_of_symbol(p);
+                    int i = search_parameter(f->body, p, q - p);
+                    if (i < 0)
+                        expand(f, &length, p, q - p);
+                    else if (i < f->number_of_arguments)
+                        expand(f, &length, f->arguments[i], strlen(f->arguments[i]));
+                    p = q;
+                }
+            else
+                {
+                    expand(f, &length, p, 1);
+                    p += 1;
+                }
+        }
+    return(f->expansion);
+}
+
+/* the next line from a frame, or NULL if it has no more */
+char *next_frame_line(struct source_frame *f)
+{
+    switch (f->kind)
+        {
+        case Finclude:
+            if (f->next_line >= f->file->number_of_lines)
+                return(NULL);
+            f->next_line += 1;
+            f->line_number = f->next_line;
+            return(f->file->lines[f->next_line - 1]);
+
+        case Fmacro:
+            if (f->next_line >= f->body->number_of_lines)
+                return(NULL);
+            f->next_line += 1;
+            return(substitute_arguments(f, f->body->lines[f->next_line - 1]));
+
+        case Frept:
+            if (f->next_line >= f->body->number_of_lines)
+                {
+                    f->count -= 1;
+                    f->next_line = 0;
+                }
+            if ((f->count <= 0) || (f->body->number_of_lines == 0))
+                return(NULL);
+            f->next_line += 1;
+            return(f->body->lines[f->next_line - 1]);
+        }
+    return(NULL);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* the directives */
+
+void do_include(Assembly *a, char *operands)
+{
+    char *p = skip_spaces(operands);
+    char *name = p;
+    int length;
+    if (*p == '"')
+        {
+            name = p + 1;
+            char *q = strchr(name, '"');
+            length = (q == NULL) ? strlen(name) : q - name;
+        }
+    else
+        {
+            while ((*p != '\0') && !isspace(*p)) p++;
+            length = p - name;
+        }
+    if (length == 0)
+        {
+            Report_Error(a, a->line_number, "INCLUDE without a file name");
+            return;
+        }
+
+    if (a->include_cache == NULL)
+        {
+            a->include_cache = New_Include_Cache();
+            a->own_include_cache = TRUE;
+        }
+    char *path = include_file_name(a, name, length);
+    struct include_file *file = find_include_file(a->include_cache, path);
+    if (file == NULL)
+        {
+            Report_Error(a, a->line_number, "Can't open include file %s", path);
+            free(path);
+            return;
+        }
+    free(path);
+
+    struct include_use *u = note_include_use(a, file);
+    struct source_frame f;
+    memset(&f, 0, sizeof(f));
+    f.kind = Finclude;
+    f.file = file;
+    f.file_number = u->number;
+    push_frame(a, &f);
+}
+
+/* start collecting the lines of a MACRO or REPT */
+void start_definition(Assembly *a, struct macro *m, int count)
+{
+    a->defining = m;
+    a->defining_depth = 1;
+    a->defining_line = a->line_number;
+    a->defining_count = count;
+    a->number_of_definition_lines = 0;
+}
+
+void do_macro(Assembly *a, char *operands)
+{
+    char *end = end_of_operands(operands);
+    char *p = skip_spaces(operands);
+    char *q = end_of_symbol(p);
+    if (!isalpha(*p))
+        {
+            Report_Error(a, a->line_number, "MACRO without a name");
+        }
+
+    struct macro *m = CAST(struct macro *, arena_alloc(&a->macro_space, sizeof(struct macro)));
+    memset(m, 0, sizeof(struct macro));
+    m->name = arena_strndup(&a->macro_space, p, q - p);
+
+    /* the parameters: symbols, separated by commas */
+    int max = 0;
+    p = q;
+    while (p < end)
+        {
+            p = skip_spaces(p);
+            if (*p == ',') p = skip_spaces(p+1);
+            if (p >= end) break;
+            q = end_of_symbol(p);
+            if (!isalpha(*p))
+                {
+                    Report_Error(a, a->line_number, "Bad MACRO parameter");
+                    break;
+                }
+            if (m->number_of_parameters >= max)
+                {
+                    char **old = m->parameters;
+                    max = (max == 0) ? 8 : 2*max;
+                    m->parameters = CAST(char **, arena_alloc(&a->macro_space, max * sizeof(char *)));
+                    if (old != NULL)
+                        memcpy(m->parameters, old, m->number_of_parameters * sizeof(char *));
+                }
+            m->parameters[m->number_of_parameters++] = arena_strndup(&a->macro_space, p, q - p);
+            p = q;
+        }
+
+    start_definition(a, m, 0);
+}
+
+void do_rept(Assembly *a, char *operands)
+{
+    char *end;
+    long count = strtol(operands, &end, 0);
+    end = skip_spaces(end);
+    if ((end == operands) || ((*end != '\0') && (*end != '/')))
+        {
+            Report_Error(a, a->line_number, "REPT needs a count");
+            count = 0;
+        }
+
+    struct macro *m = CAST(struct macro *, arena_alloc(&a->macro_space, sizeof(struct macro)));
+    memset(m, 0, sizeof(struct macro));
+    start_definition(a, m, count);
+}
+
+/* one more line of a MACRO or REPT; at the matching ENDM, it is done */
+void define_line(Assembly *a, char *line)
+{
+    int length;
+    char *word = first_word(line, &length);
+    if (word != NULL)
+        {
+            if (is_word(word, length, "MACRO") || is_word(word, length, "REPT"))
+                a->defining_depth += 1;
+            else if (is_word(word, length, "ENDM"))
+                a->defining_depth -= 1;
+        }
+
+    if (a->defining_depth > 0)
+        {
+            if (a->number_of_definition_lines >= a->max_definition_lines)
+                {
+                    a->max_definition_lines = (a->max_definition_lines == 0) ? 64 : 2*a->max_definition_lines;
+                    a->definition_lines = CAST(char **, realloc(a->definition_lines,
+                                                                 a->max_definition_lines * sizeof(char *)));
+                }
+            a->definition_lines[a->number_of_definition_lines++] =
+                arena_strndup(&a->macro_space, line, strlen(line));
+            return;
+        }
+
+    /* the ENDM: copy out the lines */
+    struct macro *m = a->defining;
+    a->defining = NULL;
+    m->number_of_lines = a->number_of_definition_lines;
+    m->lines = CAST(char **, arena_alloc(&a->macro_space, (m->number_of_lines + 1) * sizeof(char *)));
+    if (m->number_of_lines > 0)
+        memcpy(m->lines, a->definition_lines, m->number_of_lines * sizeof(char *));
+
+    if (m->name == NULL)
+        {
+            /* REPT: expand it now */
+            struct source_frame f;
+            memset(&f, 0, sizeof(f));
+            f.kind = Frept;
+            f.body = m;
+            f.count = a->defining_count;
+            f.line_number = a->line_number;
+            push_frame(a, &f);
+        }
+    else if (search_macro(a, m->name, strlen(m->name)) != NULL)
+        {
+            Report_Error(a, a->defining_line, "Redefinition of macro %s", m->name);
+        }
+    else if (m->name[0] != '\0')
+        {
+            int h = macro_hash(m->name, strlen(m->name));
+            m->next = a->macros[h];
+            a->macros[h] = m;
+        }
+}
+
+void expand_macro(Assembly *a, struct macro *m, char *operands)
+{
+    struct source_frame f;
+    memset(&f, 0, sizeof(f));
+    f.kind = Fmacro;
+    f.body = m;
+    f.line_number = a->line_number;
+
+    /* the arguments: anything, separated by commas */
+    char *end = end_of_operands(operands);
+    char *p = skip_spaces(operands);
+    if (p < end)
+        {
+            f.arguments = CAST(char **, malloc((m->number_of_parameters + 1) * sizeof(char *)));
+            while (TRUE)
+                {
+                    char *q = p;
+                    while ((q < end) && (*q != ','))
+                        {
+                            if ((*q == '\'') && (q + 2 < end) && (q[2] == '\''))
+                                q += 2;
+                            q++;
+                        }
+                    char *r = q;
+                    while ((r > p) && isspace(r[-1])) r--;
+
+                    if (f.number_of_arguments >= m->number_of_parameters)
+                        {
+                            Report_Error(a, a->line_number, "Too many arguments to macro %s", m->name);
+                            break;
+                        }
+                    f.arguments[f.number_of_arguments] = CAST(char *, malloc(r - p + 1));
+                    memcpy(f.arguments[f.number_of_arguments], p, r - p);
+                    f.arguments[f.number_of_arguments][r - p] = '\0';
+                    f.number_of_arguments += 1;
+
+                    if (q >= end) break;
+                    p = skip_spaces(q + 1);
+                }
+        }
+
+    if (!push_frame(a, &f))
+        {
+            int i;
+            for (i = 0; i < f.number_of_arguments; i++)
+                free(f.arguments[i]);
+            if (f.arguments != NULL) free(f.arguments);
+        }
+}
+
+/* Look at the line in a->input_buffer.  If it is a directive or a
+   macro call, deal with it, and cut the line off before it. */
+
+void preprocess_line(Assembly *a)
+{
+    char *line = a->input_buffer;
+
+    if (a->defining != NULL)
+        {
+            define_line(a, line);
+            a->input_line_length = 0;
+            return;
+        }
+
+    int length;
+    char *word = first_word(line, &length);
+    if (word == NULL)
+        return;
+
+    char *operands = word + length;
+    if (is_word(word, length, "INCLUDE"))
+        do_include(a, operands);
+    else if (is_word(word, length, "MACRO"))
+        do_macro(a, operands);
+    else if (is_word(word, length, "REPT"))
+        do_rept(a, operands);
+    else if (is_word(word, length, "ENDM"))
+        {
+            Report_Error(a, a->line_number, "ENDM without MACRO or REPT");
+        }
+    else
+        {
+            struct macro *m = search_macro(a, word, length);
+            if (m == NULL)
+                return;
+            expand_macro(a, m, operands);
+        }
+
+    /* leave only the labels for the assembler */
+    a->input_line_length = word - line;
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* read the next line of input, and set the token pointer to the
+   beginning of the line */
+int next_line(Assembly *a)
+{
+    while (a->frames != NULL)
+        {
+            char *line = next_frame_line(a->frames);
+            if (line == NULL)
+                {
+                    pop_frame(a);
+                    continue;
+                }
+            if ((a->frames->kind != Finclude) && (++a->expanded_lines > MAX_EXPANDED_LINES))
+                {
+                    /* give up on these, and on any more */
+                    if (a->expanded_lines == MAX_EXPANDED_LINES + 1)
+                        {
+                            Report_Error(a, a->frames->line_number, "More than %ld lines from MACRO and REPT",
+                                         MAX_EXPANDED_LINES);
+                        }
+                    while ((a->frames != NULL) && (a->frames->kind != Finclude))
+                        pop_frame(a);
+                    continue;
+                }
+            a->input_buffer = line;
+            a->input_line_length = strlen(line) + 1;
+            a->line_number = a->frames->line_number;
+            a->file_number = a->frames->file_number;
+            a->token_index = 0;
+            preprocess_line(a);
+            return(a->input_line_length);
+        }
+
+    int length = read_source_line(a);
+    a->line_number = a->source_line_number;
+    a->file_number = 0;
+    if (length == EOF)
+        {
+            if (a->defining != NULL)
+                {
+                    Report_Error(a, a->defining_line, "No ENDM for the %s",
+                                 (a->defining->name == NULL) ? "REPT" : "MACRO");
+                    a->defining = NULL;
+                }
+            return(EOF);
+        }
+    preprocess_line(a);
+    return(length);
+}
+
+/* counted and timed with -S; macros and included files are charged
+   to reading, with the arena space they take */
+int get_next_line(Assembly *a)
+{
+    if (a->stats == NULL)
+        return(next_line(a));
+
+    enum stats_phase saved = Enter_Phase(a->stats, PHASE_READ);
+    size_t before = a->macro_space.allocated;
+    int length = next_line(a);
+    STATS_ALLOCATED(a, a->macro_space.allocated - before);
+    STATS_LEAVE(a, saved);
+    return(length);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* For the cache: each included file, and the hash of its contents,
+   one per line.  A cached assembly can only be used if every file
+   it included is still the same. */
+
+void Write_Include_Dependencies(Assembly *a, FILE *f)
+{
+    struct include_use *u;
+    for (u = a->includes; u != NULL; u = u->next)
+        fprintf(f, "%016llx %s\n", u->file->hash, u->file->name);
+}
+
+Boolean Check_Include_Dependencies(struct include_cache *c, const char *text, size_t length)
+{
+    const char *p = text;
+    const char *end = text + length;
+    while (p < end)
+        {
+            const char *nl = CAST(const char *, memchr(p, '\n', end - p));
+            if ((nl == NULL) || (nl - p < 18) || (p[16] != ' ')) return(FALSE);
+
+            unsigned long long hash = strtoull(p, NULL, 16);
+            char *name = strndup(p + 17, nl - (p + 17));
+            struct include_file *file = find_include_file(c, name);
+            free(name);
+            if ((file == NULL) || (file->hash != hash)) return(FALSE);
+            p = nl + 1;
+        }
+    return(TRUE);
+}
+
+
+void Release_Preprocessor(Assembly *a)
+{
+    while (a->frames != NULL)
+        pop_frame(a);
+    if (a->definition_lines != NULL)
+        {
+            free(a->definition_lines);
+            a->definition_lines = NULL;
+        }
+    a->number_of_definition_lines = 0;
+    a->max_definition_lines = 0;
+    a->defining = NULL;
+    a->includes = NULL;
+    if (a->own_include_cache)
+        Free_Include_Cache(a->include_cache);
+    a->include_cache = NULL;
+    a->own_include_cache = FALSE;
+    memset(a->macros, 0, sizeof(a->macros));
+    arena_release(&a->macro_space);
+}
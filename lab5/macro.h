@@ -0,0 +1,107 @@
+/*
+   Assembler for PDP-8.  The preprocessor: INCLUDE, MACRO and REPT.
+*/
+
+#ifndef _MACRO_H_
+#define _MACRO_H_
+
+#include <pthread.h>
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* A macro (or the body of a REPT): its parameters and its lines,
+   exactly as they were written. */
+
+struct macro
+{
+    struct macro *next;         /* in its hash chain */
+    char  *name;                /* NULL for REPT */
+    int    number_of_parameters;
+    char **parameters;
+    int    number_of_lines;
+    char **lines;
+};
+
+/* An included file, read (and split into lines) once and kept in an
+   include cache. */
+
+struct include_file
+{
+    struct include_file *next;
+    char  *name;
+    unsigned long long hash;    /* of the contents; see cache.c */
+    char  *text;
+    int    number_of_lines;
+    char **lines;
+};
+
+/* The files read so far.  asm8 makes one cache for its run, shared
+   by all its assemblies (which may be on different threads); an
+   assembly without one makes its own, freed with the assembly, so it
+   sees each file as it is now. */
+
+struct include_cache
+{
+    struct include_file *files;
+    pthread_mutex_t lock;
+};
+
+/* the include files used by one assembly, numbered from 1 in the
+   order they were first included */
+struct include_use
+{
+    struct include_use *next;
+    struct include_file *file;
+    int    number;
+};
+
+/* Where lines come from, other than the source file itself: an
+   included file, or the expansion of a macro or a REPT.  These
+   nest, innermost first. */
+
+enum frame_kind
+{
+    Finclude,
+    Fmacro,
+    Frept
+};
+
+struct source_frame
+{
+    struct source_frame *outer;
+    enum frame_kind kind;
+    int    next_line;
+    int    line_number;         /* for the listing and error messages */
+    int    file_number;         /* and the file it is in (a->file_number) */
+
+    struct include_file *file;  /* Finclude */
+
+    struct macro *body;         /* Fmacro, Frept */
+    char **arguments;           /* Fmacro */
+    int    number_of_arguments;
+    char  *expansion;           /* the line with its arguments substituted */
+    int    expansion_size;
+    int    count;               /* Frept: times still to go */
+};
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* prototypes */
+int get_next_line(Assembly *a);
+void Release_Preprocessor(Assembly *a);
+
+int Include_Directory_Length(const char *file_name);
+const char *Include_File_Name(Assembly *a, int file_number);
+void Write_Include_Dependencies(Assembly *a, FILE *f);
+Boolean Check_Include_Dependencies(struct include_cache *c, const char *text, size_t length);
+
+struct include_cache *New_Include_Cache(void);
+void Free_Include_Cache(struct include_cache *c);
+
+#endif
@@ -0,0 +1,550 @@
+/*
+  PDP-8 Assembler:  the command line driver.
+
+  Each file named on the command line is assembled into a .out
+  object file, with its listing on stdout.  With -M, a symbol map
+  (see symmap.h) is also written to a .sym file.  With -r, the
+  output is a relocatable module (.rel) for link8 instead.  With -O,
+  the object code is improved by the peephole optimizer (optimize.c).
+  With -G N, object file segments no more than N empty words apart
+  are joined into one.  With -S, the time, calls and memory of each
+  phase of the assembly are written after its error messages.  With
+  -X, a cross reference of the symbols follows the listing.
+  With -j N, up to N files are assembled at the same time; the
+  listings and error messages are still printed in the order the
+  files were named.
+*/
+
+#include <pthread.h>
+#include <ctype.h>
+#include "asm8.h"
+#include "input.h"
+#include "opcode.h"
+#include "symbol.h"
+#include "objmem.h"
+#include "cache.h"
+#include "macro.h"
+#include "symmap.h"
+#include "reloc.h"
+#include "optimize.h"
+#include "stats.h"
+#include "xref.h"
+
+/* options, as set by the command line so far */
+Boolean debug = FALSE;
+Boolean listing = TRUE;
+Boolean symbol_map = FALSE;
+Boolean relocatable = FALSE;
+Boolean optimize = FALSE;
+int bridge_gaps = 0;
+Boolean statistics = FALSE;
+Boolean cross_reference = FALSE;
+int number_of_threads = 1;
+STRING cache_directory = NULL;
+
+/* the files INCLUDEd, read once for the whole run */
+struct include_cache *include_cache = NULL;
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* Each file to assemble is a job.  We remember the options that
+   were in effect when the file was named, so options apply only to
+   the files after them, as they always have. */
+
+struct job
+{
+    STRING  name;
+    Boolean debug;
+    Boolean listing;
+    Boolean symbol_map;
+    Boolean relocatable;
+    Boolean optimize;
+    int     bridge_gaps;
+    Boolean statistics;
+    Boolean cross_reference;
+
+    /* when assembling in parallel, the listing and the error
+       messages are collected here until it is this job's turn
+       to print them. */
+    char   *listing_text;
+    size_t  listing_size;
+    char   *error_text;
+    size_t  error_size;
+    Boolean done;
+};
+
+struct job *jobs = NULL;
+int number_of_jobs = 0;
+int max_jobs = 0;
+
+void add_job(STRING name)
+{
+    if (number_of_jobs >= max_jobs)
+        {
+            max_jobs = (max_jobs == 0) ? 16 : 2*max_jobs;
+            jobs = CAST(struct job *, realloc(jobs, max_jobs * sizeof(struct job)));
+        }
+    struct job *j = &jobs[number_of_jobs];
+    memset(j, 0, sizeof(struct job));
+    j->name = name;
+    j->debug = debug;
+    j->listing = listing;
+    j->symbol_map = symbol_map;
+    j->relocatable = relocatable;
+    j->optimize = optimize;
+    j->bridge_gaps = bridge_gaps;
+    j->statistics = statistics;
+    j->cross_reference = cross_reference;
+    number_of_jobs += 1;
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+char *change_file_name(STRING name, STRING old_ext, STRING new_ext)
+{
+    /* need enough space for the new extension */
+    int n = strlen(name) + strlen(old_ext) + 1;
+
+    /* make the copy */
+    char *news = malloc(n);
+    strcpy(news, name);
+
+    /* can we find the old extension in this file ? */
+    char *oldxs = strstr(news, old_ext);
+    if (oldxs == NULL)
+        {
+            /* there is no old extension; add the new extension */
+            news = strcat(news, new_ext);
+        }
+    else
+        {
+            while (*new_ext != '\0')
+                *oldxs++ = *new_ext++;
+            *oldxs = '\0';
+            /* find the old extension in the old string */
+            char *p = strstr(name, old_ext);
+            /* and add the part after that to the new string */
+            strcat(oldxs, &p[strlen(old_ext)]);
+        }
+    return(news);
+}
+
+
+/* write the symbol map for a job */
+void write_symbol_map(struct job *j, Assembly *a, FILE *errors)
+{
+    char *map_filename = change_file_name(j->name, ".asm", ".sym");
+    FILE *map = fopen(map_filename, "w");
+    if (map == NULL)
+        fprintf (errors, "Can't open %s\n", map_filename);
+    else
+        {
+            Write_Symbol_Map(a, map);
+            fclose(map);
+        }
+    free(map_filename);
+}
+
+
+/* assemble input to output.  If the input has already been read,
+   it is in buffer (see load_input_file); otherwise buffer is NULL.
+   If dependencies is not NULL, the files included are written to it.
+   Returns the number of errors. */
+
+int assemble(struct job *j, FILE *input, char *buffer, long length,
+             FILE *output, FILE *listing_file, FILE *errors, FILE *dependencies)
+{
+    /* the assembly is too big to put on a thread's stack */
+    Assembly *a = TYPED_MALLOC(Assembly);
+    Initialize_Assembly(a, input, output, listing_file, errors);
+    a->debug = j->debug;
+    a->listing = j->listing;
+    a->relocatable = j->relocatable;
+    a->optimize = j->optimize;
+    a->bridge_gaps = j->bridge_gaps;
+    a->cross_reference = j->cross_reference;
+    a->file_name = j->name;
+    a->include_cache = include_cache;
+    a->file_buffer = buffer;
+    a->file_length = length;
+
+    struct asm_stats stats;
+    if (j->statistics)
+        Start_Statistics(a, &stats);
+
+    /* process the input assembly file */
+    Clear_Object_Code(a);
+    Assemble_File(a);
+    Check_for_undefined_symbols(a);
+    if (a->cross_reference)
+        Write_Cross_Reference(a, listing_file);
+    if (a->number_of_errors > 0)
+        fprintf(errors, "*** %d errors in assembly\n", a->number_of_errors);
+    else if (a->optimize)
+        {
+            enum stats_phase saved = STATS_ENTER(a, PHASE_OPTIMIZE);
+            struct optimize_stats stats;
+            Optimize_Object_Code(a, &stats);
+            Report_Optimization(a, &stats);
+            STATS_LEAVE(a, saved);
+        }
+
+    enum stats_phase saved = STATS_ENTER(a, PHASE_OUTPUT);
+    if (a->relocatable)
+        Output_Relocatable_Code(a);
+    else
+        Output_Object_Code(a);
+    STATS_LEAVE(a, saved);
+    if (dependencies != NULL)
+        Write_Include_Dependencies(a, dependencies);
+    if (j->symbol_map)
+        write_symbol_map(j, a, errors);
+    if (j->statistics)
+        Report_Statistics(a, errors);
+
+    int number_of_errors = a->number_of_errors;
+    Release_Assembly(a);
+    free(a);
+    return(number_of_errors);
+}
+
+
+/* ***************************************************************** */
+
+/* With a cache directory (-C), we first look for the results of an
+   earlier assembly of exactly the same source, in the same directory
+   (which its INCLUDEs are relative to), with the same options.  If
+   there are none, we assemble as usual, but keep copies of what we
+   write, to save in the cache for next time.
+
+   Only whole files are cached.  Symbols are global to a file, so an
+   edit to one ORIG block can change the code in any other block, and
+   finding out which blocks are unaffected takes a pass over the
+   whole source -- which is most of the cost of assembling it. */
+
+/* the options that change what an assembly produces */
+Cache_Key options_key(struct job *j, Cache_Key key)
+{
+    key = hash_bytes(key, &j->listing, sizeof(j->listing));
+    key = hash_bytes(key, &j->relocatable, sizeof(j->relocatable));
+    key = hash_bytes(key, &j->optimize, sizeof(j->optimize));
+    key = hash_bytes(key, &j->bridge_gaps, sizeof(j->bridge_gaps));
+    key = hash_bytes(key, &j->cross_reference, sizeof(j->cross_reference));
+    return(key);
+}
+
+void assemble_with_cache(struct job *j, FILE *input, FILE *output,
+                         FILE *listing_file, FILE *errors)
+{
+    long length;
+    char *buffer = read_all(input, &length);
+
+    /* INCLUDEs are found relative to the source file, so the same
+       source in another directory may include other files */
+    Cache_Key key = options_key(j, start_cache_key());
+    key = hash_bytes(key, j->name, Include_Directory_Length(j->name));
+    key = hash_bytes(key, buffer, length);
+
+    /* a cached result is no good if an included file has changed */
+    struct cache_entry e;
+    Boolean hit = Read_Cache_Entry(cache_directory, key, &e);
+    if (hit && !Check_Include_Dependencies(include_cache, e.dependencies, e.dependencies_size))
+        {
+            Free_Cache_Entry(&e);
+            hit = FALSE;
+        }
+    if (!hit)
+        {
+            FILE *o = open_memstream(&e.object, &e.object_size);
+            FILE *l = open_memstream(&e.listing, &e.listing_size);
+            FILE *r = open_memstream(&e.errors, &e.errors_size);
+            FILE *d = open_memstream(&e.dependencies, &e.dependencies_size);
+            int number_of_errors = assemble(j, input, buffer, length, o, l, r, d);
+            fclose(o);
+            fclose(l);
+            fclose(r);
+            fclose(d);
+
+            /* an error may be from a file that is not there (yet),
+               which the dependencies can not show; so only keep
+               an assembly that worked */
+            if (number_of_errors == 0)
+                Write_Cache_Entry(cache_directory, key, &e);
+        }
+
+    fwrite(e.object, 1, e.object_size, output);
+    fwrite(e.listing, 1, e.listing_size, listing_file);
+    fwrite(e.errors, 1, e.errors_size, errors);
+
+    if (hit)
+        {
+            free(buffer);
+            Free_Cache_Entry(&e);
+        }
+    else
+        {
+            /* the assembly freed the buffer */
+            free(e.object);
+            free(e.listing);
+            free(e.errors);
+            free(e.dependencies);
+        }
+}
+
+
+/* ***************************************************************** */
+
+/* assemble one file; the listing goes to listing_file, and any
+   error messages to errors */
+
+void assemble_job(struct job *j, FILE *listing_file, FILE *errors)
+{
+    FILE *input = fopen(j->name,"r");
+    if (input == NULL)
+        {
+            fprintf (errors, "Can't open %s\n", j->name);
+            return;
+        }
+    char *out_filename = change_file_name(j->name, ".asm", j->relocatable ? ".rel" : ".out");
+    FILE *output = fopen(out_filename,"w");
+    if (output == NULL)
+        {
+            fprintf (errors, "Can't open %s\n",out_filename);
+            fclose(input);
+            free(out_filename);
+            return;
+        }
+
+    /* debugging output is not worth caching, the cache does not
+       keep symbol maps, and statistics are for this assembly */
+    if ((cache_directory != NULL) && !j->debug && !j->symbol_map && !j->statistics)
+        assemble_with_cache(j, input, output, listing_file, errors);
+    else
+        assemble(j, input, NULL, 0, output, listing_file, errors, NULL);
+
+    fclose(input);
+    fclose(output);
+    free(out_filename);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* The thread pool: each thread takes the next job not yet started,
+   until there are none left.  The main thread prints the results of
+   each job, in order, as soon as that job is done. */
+
+pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t job_finished = PTHREAD_COND_INITIALIZER;
+int next_job = 0;
+
+void *assembly_thread(void *arg)
+{
+    while (TRUE)
+        {
+            pthread_mutex_lock(&job_lock);
+            int i = next_job;
+            if (i < number_of_jobs) next_job += 1;
+            pthread_mutex_unlock(&job_lock);
+            if (i >= number_of_jobs) break;
+
+            struct job *j = &jobs[i];
+            FILE *listing_file = open_memstream(&j->listing_text, &j->listing_size);
+            FILE *errors = open_memstream(&j->error_text, &j->error_size);
+            assemble_job(j, listing_file, errors);
+            fclose(listing_file);
+            fclose(errors);
+
+            pthread_mutex_lock(&job_lock);
+            j->done = TRUE;
+            pthread_cond_broadcast(&job_finished);
+            pthread_mutex_unlock(&job_lock);
+        }
+    return(NULL);
+}
+
+void assemble_in_parallel(void)
+{
+    int n = number_of_threads;
+    if (n > number_of_jobs) n = number_of_jobs;
+
+    pthread_t *threads = CAST(pthread_t *, malloc(n * sizeof(pthread_t)));
+    int started = 0;
+    while (started < n)
+        {
+            if (pthread_create(&threads[started], NULL, assembly_thread, NULL) != 0)
+                break;
+            started += 1;
+        }
+    if (started == 0)
+        {
+            /* could not start any threads; do it ourselves */
+            assembly_thread(NULL);
+        }
+
+    int i;
+    for (i = 0; i < number_of_jobs; i++)
+        {
+            struct job *j = &jobs[i];
+            pthread_mutex_lock(&job_lock);
+            while (!j->done)
+                pthread_cond_wait(&job_finished, &job_lock);
+            pthread_mutex_unlock(&job_lock);
+
+            fwrite(j->listing_text, 1, j->listing_size, stdout);
+            fflush(stdout);
+            fwrite(j->error_text, 1, j->error_size, stderr);
+            free(j->listing_text);
+            free(j->error_text);
+        }
+
+    for (i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+void usage(void)
+{
+    fprintf (stderr,"usage: asm [-D] [-N] [-M] [-r] [-O] [-S] [-X] [-G gap] [-j threads] [-C cache-directory] file ...\n");
+    exit(1);
+}
+
+/* check each character of the option list for its meaning.
+   Returns the number of following arguments used (for -j N, -G N, -C dir). */
+
+int scanargs(STRING s, STRING next)
+{
+    while (*++s != '\0')
+        switch (*s)
+            {
+
+            case 'D': /* debug option */
+                debug = TRUE;
+                break;
+
+            case 'N': /* no listing */
+                listing = FALSE;
+                break;
+
+            case 'M': /* symbol map */
+                symbol_map = TRUE;
+                break;
+
+            case 'r': /* relocatable module */
+                relocatable = TRUE;
+                break;
+
+            case 'O': /* peephole optimizer */
+                optimize = TRUE;
+                break;
+
+            case 'S': /* statistics */
+                statistics = TRUE;
+                break;
+
+            case 'X': /* cross reference */
+                cross_reference = TRUE;
+                break;
+
+            case 'j': /* number of files to assemble at once */
+                if (isdigit(s[1]))
+                    {
+                        number_of_threads = atoi(&s[1]);
+                        return(0);
+                    }
+                if ((next != NULL) && isdigit(*next))
+                    {
+                        number_of_threads = atoi(next);
+                        return(1);
+                    }
+                fprintf (stderr,"asm: -j needs a number of threads\n");
+                usage();
+
+            case 'G': /* join segments with small gaps */
+                if (isdigit(s[1]))
+                    {
+                        bridge_gaps = atoi(&s[1]);
+                        return(0);
+                    }
+                if ((next != NULL) && isdigit(*next))
+                    {
+                        bridge_gaps = atoi(next);
+                        return(1);
+                    }
+                fprintf (stderr,"asm: -G needs a number of words\n");
+                usage();
+
+            case 'C': /* cache directory */
+                if (s[1] != '\0')
+                    {
+                        cache_directory = &s[1];
+                        return(0);
+                    }
+                if (next != NULL)
+                    {
+                        cache_directory = next;
+                        return(1);
+                    }
+                fprintf (stderr,"asm: -C needs a directory\n");
+                usage();
+
+            default:
+                fprintf (stderr,"asm: Bad option %c\n", *s);
+                usage();
+            }
+    return(0);
+}
+
+
+int main(int argc, STRING *argv)
+{
+
+    Initialize_Opcode_Table();
+    include_cache = New_Include_Cache();
+
+    /* main driver program.  Define the input file
+       from either standard input or a name on the
+       command line.  Process all arguments. */
+
+    while (argc > 1)
+        {
+            argc--, argv++;
+            if (**argv == '-')
+                {
+                    int used = scanargs(*argv, (argc > 1) ? argv[1] : NULL);
+                    argc -= used, argv += used;
+                }
+            else
+                add_job(*argv);
+        }
+
+    if (number_of_threads <= 1)
+        {
+            int i;
+            for (i = 0; i < number_of_jobs; i++)
+                assemble_job(&jobs[i], stdout, stderr);
+        }
+    else
+        assemble_in_parallel();
+
+    free(jobs);
+    Free_Include_Cache(include_cache);
+    exit(0);
+}
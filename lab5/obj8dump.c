@@ -1,133 +1,72 @@
 
-/* obj8dump -- print an OBJ8 object file to check it's correctness */
+/* obj8dump -- print an OBJ8 object file to check it's correctness.
+   With -s map, each address is followed by the symbol it is at (or
+   after), from a symbol map written by asm8 -M (see symmap.h). */
 
 /* ***************************************************************** */
 /*                                                                   */
 /*                                                                   */
 /* ***************************************************************** */
 
-#include <stdio.h>
-#include <stdlib.h>
-
-typedef short Boolean;
-#define TRUE 1
-#define FALSE 0
+#include "asm8.h"
+#include "obj8read.h"
+#include "symmap.h"
 
 Boolean debug = FALSE;
-
-typedef char *STRING;
-
-#define CAST(t,e) ((t)(e))
-#define TYPED_MALLOC(t) CAST(t*, malloc(sizeof(t)))
+Symbol_Map *symbol_map = NULL;
 
 /* ***************************************************************** */
 /*                                                                   */
 /*                                                                   */
 /* ***************************************************************** */
 
-
-/* print representation of a character for debugging */
-char   *printrep (unsigned short  c)
+/* the symbol for addr, as LOOP or LOOP+3, if there is a map */
+void print_symbol(FILE *f, int addr)
 {
-    static char pr[8];
-
-    if (c < 32)
-        {
-            /* control characters */
-            pr[0] = '^';
-            pr[1] = c + 64;
-            pr[2] = '\0';
-        }
-    else if (c < 127)
-        {
-            /* printing characters */
-            pr[0] = c;
-            pr[1] = '\0';
-        }
-    else if (c == 127)
-        return("<del>");
-    else if (c <= 0377)
-        {
-            /* upper 128 codes from 128 to 255;  print as \ooo - octal  */
-            pr[0] = '\\';
-            pr[3] = '0' + (c & 7);
-            c = c >> 3;
-            pr[2] = '0' + (c & 7);
-            c = c >> 3;
-            pr[1] = '0' + (c & 3);
-            pr[4] = '\0';
-        }
+    struct map_symbol s;
+    if ((symbol_map == NULL) || !Symbolize_Address(symbol_map, addr, &s))
+        return;
+    if (s.address == addr)
+        fprintf(f, "  %s", s.name);
     else
-        {
-            /* very large number -- print as 0xffff - 4 digit hex */
-            (void)sprintf(pr, "0x%04x", c);
-        }
-    return(pr);
-}
-
-
-/* ***************************************************************** */
-/*                                                                   */
-/*                                                                   */
-/* ***************************************************************** */
-
-int get2(FILE *input)
-{
-    int c1 = getc(input);
-    int c2 = getc(input);
-    if (debug) fprintf(stderr, "read two bytes: 0x%X, 0x%X\n", c1, c2);
-
-    if ((c1 == EOF) || (c2 == EOF))
-        {
-            fprintf(stderr, "Premature EOF\n");
-            exit(1);
-        }
-
-    if (c1 & (~0x3F)) fprintf(stderr, "Extra high order bits for 0x%X\n", c1);
-    if (c2 & (~0x3F)) fprintf(stderr, "Extra high order bits for 0x%X\n", c2);
-    int n = ((c1 & 0x3F) << 6) | (c2 & 0x3F);
-    return(n);
+        fprintf(f, "  %s+%d", s.name, addr - s.address);
 }
 
-
 void Read_and_Dump_PDP8_Object_File(FILE *input)
 {
-    int c1 = getc(input);
-    int c2 = getc(input);
-    int c3 = getc(input);
-    int c4 = getc(input);
-    if (debug) fprintf(stderr, "read four bytes: 0x%X, 0x%X, 0x%X, 0x%X\n", c1, c2, c3, c4);
+    struct obj8_image *image = TYPED_MALLOC(struct obj8_image);
 
-    if ((c1 != 'O') || (c2 != 'B') || (c3 != 'J') || (c4 != '8'))
+    int error = Read_OBJ8_Stream(input, image);
+    if (error != OBJ8_OK)
         {
-            fprintf(stderr, "First four bytes are not OBJ8: ");
-            fprintf(stderr, "%s", printrep(c1));
-            fprintf(stderr, "%s", printrep(c2));
-            fprintf(stderr, "%s", printrep(c3));
-            fprintf(stderr, "%s", printrep(c4));
-            fprintf(stderr, " (%02X %02X %02X %02X)\n", c1, c2, c3, c4);
+            fprintf(stderr, "%s", OBJ8_Error_Message(error));
+            if (error != OBJ8_BAD_HEADER) fprintf(stderr, " at byte %ld", image->error_offset);
+            fprintf(stderr, "\n");
             exit(1);
         }
+    if (image->extra_bits > 0)
+        fprintf(stderr, "Extra high order bits in %d words, the first at byte %ld\n",
+                image->extra_bits, image->first_extra_bits);
 
-    int EP = get2(input);
-    fprintf(stdout, "EP: %03X\n", EP);
+    fprintf(stdout, "EP: %03X", image->entry_point);
+    print_symbol(stdout, image->entry_point);
+    fprintf(stdout, "\n");
 
-    int n;
-    while ((n = getc(input)) != EOF)
+    int i;
+    for (i = 0; i < image->number_of_segments; i++)
         {
-            if (debug) fprintf(stderr, "Read next block of %d bytes\n", n);
-            n = n - 1;
-            int addr = get2(input); n -= 2;
-            while (n > 0)
+            struct obj8_segment *s = &image->segments[i];
+            if (debug) fprintf(stderr, "Segment of %d words at 0x%03X\n", s->length, s->address);
+            int addr;
+            for (addr = s->address; addr < s->address + s->length; addr++)
                 {
-                    int data = get2(input); n -= 2;
-                    fprintf(stdout, "%03X: %03X\n", addr, data);
-                    addr += 1;
+                    fprintf(stdout, "%03X: %03X", addr, image->memory[addr]);
+                    print_symbol(stdout, addr);
+                    fprintf(stdout, "\n");
                 }
         }
 
-    if (debug)
-        fprintf(stderr, "EOF\n");
+    free(image);
 }
 
 /* ***************************************************************** */
@@ -135,11 +74,17 @@ void Read_and_Dump_PDP8_Object_File(FILE *input)
 /*                                                                   */
 /* ***************************************************************** */
 
-void scanargs(STRING s)
+void usage(void)
 {
-    /* check each character of the option list for
-       its meaning. */
+    fprintf (stderr,"usage: obj8dump [-D] [-s map] file\n");
+    exit(1);
+}
+
+/* check each character of the option list for its meaning.
+   Returns the number of following arguments used (for -s map). */
 
+int scanargs(STRING s, STRING next)
+{
     while (*++s != '\0')
         switch (*s)
             {
@@ -148,11 +93,28 @@ void scanargs(STRING s)
                 debug = TRUE;
                 break;
 
+            case 's': /* symbol map */
+                {
+                    STRING name = (s[1] != '\0') ? &s[1] : next;
+                    if (name == NULL)
+                        {
+                            fprintf (stderr,"obj8dump: -s needs a symbol map\n");
+                            usage();
+                        }
+                    symbol_map = Load_Symbol_Map(name);
+                    if (symbol_map == NULL)
+                        {
+                            fprintf (stderr,"obj8dump: %s is not a symbol map\n", name);
+                            exit(1);
+                        }
+                    return((s[1] != '\0') ? 0 : 1);
+                }
+
             default:
                 fprintf (stderr,"obj8dump: Bad option %c\n", *s);
-                fprintf (stderr,"usage: obj8dump [-D] file\n");
-                exit(1);
+                usage();
             }
+    return(0);
 }
 
 
@@ -173,7 +135,10 @@ int main(int argc, STRING *argv)
         {
             argc--, argv++;
             if (**argv == '-')
-                scanargs(*argv);
+                {
+                    int used = scanargs(*argv, (argc > 1) ? argv[1] : NULL);
+                    argc -= used, argv += used;
+                }
             else
                 {
                     FILE *input;
@@ -197,6 +162,7 @@ int main(int argc, STRING *argv)
             Read_and_Dump_PDP8_Object_File(stdin);
         }
 
+    if (symbol_map != NULL) Free_Symbol_Map(symbol_map);
     exit(0);
 }
 
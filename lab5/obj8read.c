@@ -0,0 +1,192 @@
+/*
+   Reading PDP-8 object files (OBJ8).  See obj8read.h.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "obj8read.h"
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* a word from two bytes at p; each should have only 6 bits */
+int obj8_word(const unsigned char *p, const unsigned char *data, struct obj8_image *image)
+{
+    if ((p[0] & ~0x3F) || (p[1] & ~0x3F))
+        {
+            if (image->extra_bits == 0) image->first_extra_bits = p - data;
+            image->extra_bits += 1;
+        }
+    return(((p[0] & 0x3F) << 6) | (p[1] & 0x3F));
+}
+
+int Parse_OBJ8(const unsigned char *data, long size, struct obj8_image *image)
+{
+    memset(image, 0, sizeof(struct obj8_image));
+
+    if ((size < 6) || (memcmp(data, "OBJ8", 4) != 0))
+        return(OBJ8_BAD_HEADER);
+    image->entry_point = obj8_word(&data[4], data, image);
+
+    long i = 6;
+    while (i < size)
+        {
+            image->error_offset = i;
+            int n = data[i];
+            if ((n < 3) || ((n & 1) == 0)) return(OBJ8_BAD_SEGMENT);
+            if (i + n > size) return(OBJ8_SHORT_SEGMENT);
+            if (image->number_of_segments >= OBJ8_MAX_SEGMENTS) return(OBJ8_TOO_MANY_SEGMENTS);
+
+            int addr = obj8_word(&data[i+1], data, image);
+            int length = (n - 3) / 2;
+            if (addr + length > OBJ8_MEMORY_SIZE) return(OBJ8_PAST_MEMORY);
+
+            struct obj8_segment *s = &image->segments[image->number_of_segments++];
+            s->address = addr;
+            s->length = length;
+
+            const unsigned char *p = &data[i+3];
+            int k;
+            for (k = 0; k < length; k++)
+                {
+                    image->memory[addr + k] = obj8_word(p, data, image);
+                    image->loaded[addr + k] = 1;
+                    p += 2;
+                }
+            i += n;
+        }
+    image->error_offset = 0;
+    return(OBJ8_OK);
+}
+
+int Read_OBJ8_Stream(FILE *f, struct obj8_image *image)
+{
+    size_t size = 65536;
+    size_t n = 0;
+    unsigned char *data = (unsigned char *)malloc(size);
+    size_t got;
+    while ((got = fread(&data[n], 1, size - n, f)) > 0)
+        {
+            n += got;
+            if (n == size)
+                {
+                    size = 2*size;
+                    data = (unsigned char *)realloc(data, size);
+                }
+        }
+    int error = Parse_OBJ8(data, n, image);
+    free(data);
+    return(error);
+}
+
+int Read_OBJ8_File(const char *name, struct obj8_image *image)
+{
+    FILE *f = fopen(name, "r");
+    if (f == NULL)
+        {
+            memset(image, 0, sizeof(struct obj8_image));
+            return(OBJ8_CANT_OPEN);
+        }
+    int error = Read_OBJ8_Stream(f, image);
+    fclose(f);
+    return(error);
+}
+
+const char *OBJ8_Error_Message(int error)
+{
+    switch (error)
+        {
+        case OBJ8_OK:                return("ok");
+        case OBJ8_CANT_OPEN:         return("can't open file");
+        case OBJ8_BAD_HEADER:        return("not an OBJ8 file");
+        case OBJ8_BAD_SEGMENT:       return("bad segment length");
+        case OBJ8_SHORT_SEGMENT:     return("file ends in the middle of a segment");
+        case OBJ8_PAST_MEMORY:       return("segment goes past the end of memory");
+        case OBJ8_TOO_MANY_SEGMENTS: return("too many segments");
+        case OBJ8_BAD_HEX_LINE:      return("bad line");
+        }
+    return("unknown error");
+}
+
+
+/* A text image.  error_offset is the line number of a bad line. */
+
+int Read_OBJ8_Hex_File(const char *name, struct obj8_image *image)
+{
+    memset(image, 0, sizeof(struct obj8_image));
+    FILE *f = fopen(name, "r");
+    if (f == NULL) return(OBJ8_CANT_OPEN);
+
+    int error = OBJ8_OK;
+    char line[128];
+    long line_number = 0;
+    while (fgets(line, sizeof(line), f) != NULL)
+        {
+            line_number += 1;
+            unsigned int addr, value;
+            if ((line[0] == '\n') || ((line[0] == '\r') && (line[1] == '\n')))
+                continue;
+            if (sscanf(line, "EP: %x", &value) == 1)
+                image->entry_point = value & 0xFFF;
+            else if ((sscanf(line, "%x: %x", &addr, &value) == 2) && (addr < OBJ8_MEMORY_SIZE))
+                {
+                    image->memory[addr] = value & 0xFFF;
+                    image->loaded[addr] = 1;
+                }
+            else
+                {
+                    image->error_offset = line_number;
+                    error = OBJ8_BAD_HEX_LINE;
+                    break;
+                }
+        }
+    fclose(f);
+    return(error);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* Compare two memory images (words not loaded are zero, as they
+   would be in a fresh machine).  The first max_ranges ranges of
+   different words are put in ranges; returns how many there are in
+   all, which may be more. */
+
+int Diff_OBJ8_Images(const struct obj8_image *x, const struct obj8_image *y,
+                     struct obj8_range *ranges, int max_ranges)
+{
+    int count = 0;
+    int i = 0;
+    while (i < OBJ8_MEMORY_SIZE)
+        {
+            /* skip the same words a long long at a time */
+            if (((i % 4) == 0) && (i + 4 <= OBJ8_MEMORY_SIZE)
+                && (memcmp(&x->memory[i], &y->memory[i], 4 * sizeof(unsigned short)) == 0))
+                {
+                    i += 4;
+                    continue;
+                }
+            if (x->memory[i] == y->memory[i])
+                {
+                    i += 1;
+                    continue;
+                }
+
+            int first = i;
+            while ((i < OBJ8_MEMORY_SIZE) && (x->memory[i] != y->memory[i]))
+                i += 1;
+            if (count < max_ranges)
+                {
+                    ranges[count].first = first;
+                    ranges[count].last = i - 1;
+                }
+            count += 1;
+        }
+    return(count);
+}
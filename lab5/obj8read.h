@@ -0,0 +1,88 @@
+/*
+   Reading PDP-8 object files (OBJ8), for the tools that check them:
+   obj8dump and the grading validator (which is C++).
+*/
+
+#ifndef _OBJ8READ_H_
+#define _OBJ8READ_H_
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* An OBJ8 file is "OBJ8", the entry point, and then segments: a count
+   byte (2*words + 3), the address of the first word, and the words.
+   Each word (and address) is two bytes of 6 bits each.
+
+   A file is read all at once, and checked as it is taken apart; the
+   memory image it loads is an obj8_image. */
+
+#define OBJ8_MEMORY_SIZE  4096
+#define OBJ8_MAX_SEGMENTS 4096
+
+struct obj8_segment
+{
+    int address;
+    int length;                 /* in words */
+};
+
+struct obj8_image
+{
+    int entry_point;
+    unsigned short memory[OBJ8_MEMORY_SIZE];     /* zero if not loaded */
+    unsigned char  loaded[OBJ8_MEMORY_SIZE];
+
+    /* the segments, in the order they are in the file */
+    int number_of_segments;
+    struct obj8_segment segments[OBJ8_MAX_SEGMENTS];
+
+    /* bytes with more than 6 bits; the words are still used */
+    int extra_bits;
+    long first_extra_bits;      /* offset in the file of the first */
+
+    /* where a bad file went wrong */
+    long error_offset;
+};
+
+/* what is wrong with a file */
+#define OBJ8_OK               0
+#define OBJ8_CANT_OPEN        1
+#define OBJ8_BAD_HEADER       2     /* not "OBJ8", or no entry point */
+#define OBJ8_BAD_SEGMENT      3     /* the count is too small, or even */
+#define OBJ8_SHORT_SEGMENT    4     /* the file ends in the middle of one */
+#define OBJ8_PAST_MEMORY      5     /* it goes past the end of memory */
+#define OBJ8_TOO_MANY_SEGMENTS 6
+#define OBJ8_BAD_HEX_LINE     7     /* in a text (hex) image */
+
+/* a range of addresses, first to last, where two images differ */
+struct obj8_range
+{
+    int first;
+    int last;
+};
+
+/* prototypes */
+int Parse_OBJ8(const unsigned char *data, long size, struct obj8_image *image);
+int Read_OBJ8_Stream(FILE *f, struct obj8_image *image);
+int Read_OBJ8_File(const char *name, struct obj8_image *image);
+const char *OBJ8_Error_Message(int error);
+
+/* the same memory image written as text, as obj8dump prints it:
+   "EP: xxx" and then a line "aaa: www" for each word */
+int Read_OBJ8_Hex_File(const char *name, struct obj8_image *image);
+
+int Diff_OBJ8_Images(const struct obj8_image *x, const struct obj8_image *y,
+                     struct obj8_range *ranges, int max_ranges);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
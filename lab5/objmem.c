@@ -3,6 +3,9 @@
 */
 
 #include "asm8.h"
+#include "error.h"
+#include "objmem.h"
+#include "stats.h"
 
 
 /* ***************************************************************** */
@@ -18,84 +21,193 @@
 
    We need to know which memory locations are from assembled
    instructions, and which are just empty; so each memory location
-   has a bit (defined/not defined).
+   has a bit (defined/not defined).  The memory and the defined bits
+   are part of the Assembly.  The bits are kept 64 to a word, so
+   runs of them can be looked at all at once (Next_Defined,
+   Count_Defined).
 */
 
-INST     memory[4096];
-Boolean defined[4096];
-Address entry_point = 0;
+#define DEFINED_BIT(addr) (1ULL << ((addr) % 64))
 
+void Clear_Object_Code(Assembly *a)
+{
+    memset(a->defined_bits, 0, sizeof(a->defined_bits));
+    memset(a->word_kind, WORD_DATA, sizeof(a->word_kind));
+    a->entry_point = 0;
+}
+
+Boolean Is_Defined(Assembly *a, Address addr)
+{
+    addr = addr & 0xFFF;
+    return((a->defined_bits[addr / 64] & DEFINED_BIT(addr)) != 0);
+}
+
+void Undefine_Object_Code(Assembly *a, Address addr)
+{
+    addr = addr & 0xFFF;
+    a->defined_bits[addr / 64] &= ~DEFINED_BIT(addr);
+}
+
+/* the first address, from i on, that is defined (or, if want is
+   FALSE, not defined); 4096 if there is none */
+int Next_Defined(Assembly *a, int i, Boolean want)
+{
+    while (i < 4096)
+        {
+            /* the bits we want in this word, from i on */
+            unsigned long long w = a->defined_bits[i / 64];
+            if (!want) w = ~w;
+            w = w & (~0ULL << (i % 64));
+            if (w != 0)
+                return((i & ~63) + __builtin_ctzll(w));
+            i = (i & ~63) + 64;
+        }
+    return(4096);
+}
 
-void Clear_Object_Code(void)
+/* how many words from addresses from up to (not including) to are defined */
+int Count_Defined(Assembly *a, int from, int to)
 {
-    int i;
-    for (i = 0; i < 4096; i++)
+    int count = 0;
+    while (from < to)
         {
-            defined[i] = FALSE;
+            unsigned long long w = a->defined_bits[from / 64] & (~0ULL << (from % 64));
+            int end = (from & ~63) + 64;
+            if (end > to)
+                {
+                    w = w & ~(~0ULL << (to % 64));
+                    end = to;
+                }
+            count += __builtin_popcountll(w);
+            from = end;
         }
+    return(count);
 }
 
-void Define_Object_Code(Address addr, INST inst, Boolean redefine)
+void Define_Object_Code(Assembly *a, Address addr, INST inst, Boolean redefine)
 {
-    if (debug)
-        fprintf(stderr, "object code: 0x%03X = 0x%03X\n", addr, inst);
-    if (defined[addr] && !redefine)
+    addr = addr & 0xFFF;        /* memory wraps around */
+    if (a->debug)
+        fprintf(a->errors, "object code: 0x%03X = 0x%03X\n", addr, inst);
+    if (Is_Defined(a, addr) && !redefine)
         {
-            fprintf(stderr, "redefined memory location: 0x%03X: was 0x%03X; new value 0x%03X\n",
-                    addr, memory[addr], inst);
-            number_of_errors += 1;
+            Report_Error(a, a->line_number, "redefined memory location: 0x%03X: was 0x%03X; new value 0x%03X",
+                         addr, a->memory[addr], inst);
         }
 
-    defined[addr] = TRUE;
-    memory[addr] = inst;
+    a->defined_bits[addr / 64] |= DEFINED_BIT(addr);
+    a->memory[addr] = inst;
 }
 
-INST Fetch_Object_Code(Address addr)
+INST Fetch_Object_Code(Assembly *a, Address addr)
 {
     INST inst;
 
-    if (defined[addr])
-        inst = memory[addr];
+    addr = addr & 0xFFF;
+    if (Is_Defined(a, addr))
+        inst = a->memory[addr];
     else
         inst = 0;
 
-    if (debug)
-        fprintf(stderr, "read object code: 0x%03X = 0x%03X\n", addr, inst);
+    if (a->debug)
+        fprintf(a->errors, "read object code: 0x%03X = 0x%03X\n", addr, inst);
     return(inst);
 }
 
+/* a memory reference instruction at pc, to addr: it must be on page
+   zero, or the same page as the instruction */
+INST Adjust_for_ZC(Assembly *a, Address pc, INST instruction, Address addr, int line_number)
+{
+    Address addr_page = (addr & 0xF80);
+    Address curr_page = (pc & 0xF80);
+    /* set the Z/C bit for this address */
+    if (addr_page == 0)
+        {
+            /* set Z/C bit to zero */
+            instruction = instruction & ~(0x080);
+        }
+    else if (addr_page == curr_page)
+        {
+            /* set Z/C bit to one */
+            instruction = instruction | 0x080;
+        }
+    else
+        {
+            Report_Error(a, line_number, "Address is not on zero or current page: Address page = 0x%3X, Current page = 0x%3X",
+                         addr_page, curr_page);
+        }
+
+    /* add in address page offset to the instruction */
+    instruction = instruction | (addr & 0x07F);
+
+    return(instruction);
+}
+
+
 void splitIntoTwoBytes(short org, char* twoByte) {
     twoByte[0] = (org >> 6) & 0x3F;
     twoByte[1] = org & 0x3F;
 }
 
-void Output_Object_Code(void) {
-    char twoByte[2];
-    int i = 0;
-    int j;
-    fputs("OBJ8", output);
-    splitIntoTwoBytes(entry_point, twoByte);
-    fwrite(twoByte, 1, 2, output);
-    while (1) {
-        while (i < 4096 && !defined[i]) {
-            ++i;
-        }
-        if (4096 <= i) {
-            break;
-        }
-        for (j = i; j < 4096 && (j - i) < 126; ++j) {
-            if (!defined[j]) {
-                break;
-            }
-        }
-        fputc(2 * (j - i) + 3, output);
-        splitIntoTwoBytes(i, twoByte);
-        fwrite(twoByte, 1, 2, output);
-        while (i < j) {
-            splitIntoTwoBytes(memory[i], twoByte);
-            fwrite(twoByte, 1, 2, output);
-            ++i;
-        }
-    }
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* The object file: "OBJ8", the entry point, then segments of
+   consecutive words.  Each segment is a count byte (2*words + 3),
+   its address, and its words; so no more than 126 words in one.
+
+   The whole file is built in one buffer and written at once.  With
+   a->bridge_gaps (-G n), two segments with no more than n empty
+   words between them are written as one, the empty words as zero;
+   a gap of one word is then smaller than a new segment header. */
+
+#define MAX_SEGMENT 126
+
+/* the largest it can be: every word in a segment of its own */
+#define OBJ8_MAX_SIZE (6 + 4096*(3 + 2))
+
+void put_obj_word(unsigned char *p, Address n)
+{
+    splitIntoTwoBytes(n, CAST(char *, p));
 }
 
+void Output_Object_Code(Assembly *a)
+{
+    unsigned char *image = CAST(unsigned char *, malloc(OBJ8_MAX_SIZE));
+    STATS_ALLOCATED(a, OBJ8_MAX_SIZE);
+    int n = 0;
+
+    memcpy(image, "OBJ8", 4);
+    put_obj_word(&image[4], a->entry_point);
+    n = 6;
+
+    int i = Next_Defined(a, 0, TRUE);
+    while (i < 4096)
+        {
+            /* this run of words, and any close enough after it */
+            int limit = (i + MAX_SEGMENT < 4096) ? i + MAX_SEGMENT : 4096;
+            int j = Next_Defined(a, i, FALSE);
+            while ((j < limit) && (a->bridge_gaps > 0))
+                {
+                    int k = Next_Defined(a, j, TRUE);
+                    if ((k >= limit) || (k - j > a->bridge_gaps)) break;
+                    j = Next_Defined(a, k, FALSE);
+                }
+            if (j > limit) j = limit;
+
+            image[n] = 2 * (j - i) + 3;
+            put_obj_word(&image[n+1], i);
+            n += 3;
+            for (; i < j; i++)
+                {
+                    put_obj_word(&image[n], Is_Defined(a, i) ? a->memory[i] : 0);
+                    n += 2;
+                }
+            i = Next_Defined(a, j, TRUE);
+        }
+
+    fwrite(image, 1, n, a->output);
+    free(image);
+}
@@ -2,13 +2,20 @@
    Assembler for PDP-8.  Memory and object file creation header file
 */
 
-/* variables */
-Address entry_point;
-
+/* what a word of memory holds (a->word_kind), for the optimizer */
+#define WORD_DATA        0      /* a number, or we do not know */
+#define WORD_INSTRUCTION 1
+#define WORD_ADDRESS     2      /* the value of a symbol */
 
 /* prototypes */
-void Clear_Object_Code(void);
-void Define_Object_Code(Address addr, INST inst, Boolean redefine);
-INST Fetch_Object_Code(Address addr);
-void Output_Object_Code(void);
+void Clear_Object_Code(Assembly *a);
+void Define_Object_Code(Assembly *a, Address addr, INST inst, Boolean redefine);
+INST Fetch_Object_Code(Assembly *a, Address addr);
+Boolean Is_Defined(Assembly *a, Address addr);
+void Undefine_Object_Code(Assembly *a, Address addr);
+int Next_Defined(Assembly *a, int i, Boolean want);
+int Count_Defined(Assembly *a, int from, int to);
+INST Adjust_for_ZC(Assembly *a, Address pc, INST instruction, Address addr, int line_number);
+void Output_Object_Code(Assembly *a);
+void splitIntoTwoBytes(short org, char* twoByte);
 
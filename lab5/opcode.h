@@ -13,11 +13,11 @@
 /*                                                                   */
 /* ***************************************************************** */
 
-enum opcode_kind {k_memref, k_operate, k_operate1, k_operate2, k_iot, k_orig, k_end, k_indirect};
+enum opcode_kind {k_memref, k_operate, k_operate1, k_operate2, k_iot, k_orig, k_end, k_indirect,
+                  k_global, k_extern};
 
 struct opcode_table_entry
 {
-    struct opcode_table_entry *next;
     const char       *name;
     enum opcode_kind  class;
     INST  value;
@@ -28,7 +28,7 @@ typedef struct opcode_table_entry opcode;
 /* function prototypes */
 
 void Initialize_Opcode_Table(void);
-opcode *search_opcode(char *name);
+const opcode *search_opcode(const char *name, int length);
 
 
 #endif
@@ -11,79 +11,101 @@
 /*                                                                   */
 /* ***************************************************************** */
 
-opcode *Root_OP = NULL;
+/* The set of opcodes is fixed, so rather than build a list at run
+   time and search it, we build a perfect hash table at compile time.
+   The hash uses the low 5 bits of the first three characters (which
+   folds upper and lower case letters together); for the opcodes we
+   have, no two of them land in the same slot (GLOBAL and EXTERN
+   needed the table to grow from 64 to 128 slots for that).  A lookup is then one
+   hash computation and one string compare.
 
+   If you add an opcode, check that it does not collide with an
+   existing one: Initialize_Opcode_Table will complain if it does. */
 
-/* ***************************************************************** */
-/*                                                                   */
-opcode *search_opcode(char *name)
+#define OPCODE_HASH_SIZE 128
+#define OPCODE_HASH(c0,c1,c2) \
+    ((((c0) & 0x1F) + ((c1) & 0x1F) + ((c2) & 0x1F) * 44) & (OPCODE_HASH_SIZE-1))
+
+#define NUMBER_OF_OPCODES 32
+
+/* for each opcode, we need it's name, what type of
+   opcode it is, it's numeric opcode, and what bits
+   of the numeric opcode are important. */
+
+static const opcode opcode_table[OPCODE_HASH_SIZE] =
 {
-    opcode *o;
-    for (o = Root_OP; o != NULL; o = o->next)
-        if (strcasecmp(name, o->name) == 0) break;
-    return(o);
-}
+    [OPCODE_HASH('A','N','D')] = { "AND",  k_memref,   0x000, 0xE00 },
+    [OPCODE_HASH('T','A','D')] = { "TAD",  k_memref,   0x200, 0xE00 },
+    [OPCODE_HASH('I','S','Z')] = { "ISZ",  k_memref,   0x400, 0xE00 },
+    [OPCODE_HASH('D','C','A')] = { "DCA",  k_memref,   0x600, 0xE00 },
+    [OPCODE_HASH('J','M','S')] = { "JMS",  k_memref,   0x800, 0xE00 },
+    [OPCODE_HASH('J','M','P')] = { "JMP",  k_memref,   0xA00, 0xE00 },
+    [OPCODE_HASH('C','L','A')] = { "CLA",  k_operate,  0xE80, 0x080 },
+    [OPCODE_HASH('C','L','L')] = { "CLL",  k_operate1, 0xE40, 0x140 },
+    [OPCODE_HASH('C','M','A')] = { "CMA",  k_operate1, 0xE20, 0x120 },
+    [OPCODE_HASH('C','M','L')] = { "CML",  k_operate1, 0xE10, 0x110 },
+    [OPCODE_HASH('R','A','R')] = { "RAR",  k_operate1, 0xE08, 0x10A },
+    [OPCODE_HASH('R','A','L')] = { "RAL",  k_operate1, 0xE04, 0x106 },
+    [OPCODE_HASH('R','T','R')] = { "RTR",  k_operate1, 0xE0A, 0x10A },
+    [OPCODE_HASH('R','T','L')] = { "RTL",  k_operate1, 0xE06, 0x106 },
+    [OPCODE_HASH('I','A','C')] = { "IAC",  k_operate1, 0xE01, 0x101 },
+    [OPCODE_HASH('S','M','A')] = { "SMA",  k_operate2, 0xF40, 0x140 },
+    [OPCODE_HASH('S','Z','A')] = { "SZA",  k_operate2, 0xF20, 0x120 },
+    [OPCODE_HASH('S','N','L')] = { "SNL",  k_operate2, 0xF10, 0x110 },
+    [OPCODE_HASH('R','S','S')] = { "RSS",  k_operate2, 0xF08, 0x108 },
+    [OPCODE_HASH('O','S','R')] = { "OSR",  k_operate2, 0xF04, 0x104 },
+    [OPCODE_HASH('H','L','T')] = { "HLT",  k_operate2, 0xF02, 0x102 },
+    [OPCODE_HASH('N','O','P')] = { "NOP",  k_operate,  0xE00, 0x1FF },
+    [OPCODE_HASH('S','P','A')] = { "SPA",  k_operate2, 0xF48, 0x148 },
+    [OPCODE_HASH('S','N','A')] = { "SNA",  k_operate2, 0xF28, 0x128 },
+    [OPCODE_HASH('S','Z','L')] = { "SZL",  k_operate2, 0xF18, 0x118 },
+    [OPCODE_HASH('S','K','P')] = { "SKP",  k_operate2, 0xF08, 0x178 },
+    [OPCODE_HASH('I','O','T')] = { "IOT",  k_iot,      0xC00, 0x000 },
+    [OPCODE_HASH('O','R','I')] = { "ORIG", k_orig,     0x000, 0x000 },
+    [OPCODE_HASH('E','N','D')] = { "END",  k_end,      0x000, 0x000 },
+    [OPCODE_HASH('G','L','O')] = { "GLOBAL", k_global, 0x000, 0x000 },
+    [OPCODE_HASH('E','X','T')] = { "EXTERN", k_extern, 0x000, 0x000 },
+    [OPCODE_HASH('I', 0,  0 )] = { "I",    k_indirect, 0x100, 0x000 },
+};
 
 
 /* ***************************************************************** */
 /*                                                                   */
-void define_opcode(char *name, enum opcode_kind kind, INST op, INST mask)
+/* name need not be null terminated; length is the number of characters */
+const opcode *search_opcode(const char *name, int length)
 {
-    opcode *o;
+    /* all the opcodes are short; don't bother with anything long */
+    if ((length <= 0) || (length > 6)) return(NULL);
 
-    o = search_opcode(name);
-    if (o != NULL)
-        {
-            fprintf(stderr, "opcode %s redefined; old value = 0x%03X, new value = 0x%03X\n", name, o->value, op);
-        }
-    else
-        {
-            o = TYPED_MALLOC(opcode);
-        }
-    o->name = name;
-    o->class = kind;
-    o->value = op;
-    o->mask = mask;
-    o->next = Root_OP;
-    Root_OP = o;
-}
+    /* hash the first three characters, being careful not to
+       look past the end of a short name */
+    char c0 = name[0];
+    char c1 = (length > 1) ? name[1] : '\0';
+    char c2 = (length > 2) ? name[2] : '\0';
 
+    const opcode *o = &opcode_table[OPCODE_HASH(c0, c1, c2)];
+    if ((o->name != NULL)
+        && (strncasecmp(name, o->name, length) == 0) && (o->name[length] == '\0'))
+        return(o);
+    return(NULL);
+}
 
-/* for each opcode, we need it's name, what type of
-   opcode it is, it's numeric opcode, and what bits
-   of the numeric opcode are important. */
 
+/* ***************************************************************** */
+/*                                                                   */
 void Initialize_Opcode_Table(void)
 {
-    define_opcode("AND", k_memref, 0x000, 0xE00);
-    define_opcode("TAD", k_memref, 0x200, 0xE00);
-    define_opcode("ISZ", k_memref, 0x400, 0xE00);
-    define_opcode("DCA", k_memref, 0x600, 0xE00);
-    define_opcode("JMS", k_memref, 0x800, 0xE00);
-    define_opcode("JMP", k_memref, 0xA00, 0xE00);
-    define_opcode("CLA", k_operate,  0xE80, 0x080);
-    define_opcode("CLL", k_operate1,  0xE40, 0x140);
-    define_opcode("CMA", k_operate1,  0xE20, 0x120);
-    define_opcode("CML", k_operate1,  0xE10, 0x110);
-    define_opcode("RAR", k_operate1,  0xE08, 0x10A);
-    define_opcode("RAL", k_operate1,  0xE04, 0x106);
-    define_opcode("RTR", k_operate1,  0xE0A, 0x10A);
-    define_opcode("RTL", k_operate1,  0xE06, 0x106);
-    define_opcode("IAC", k_operate1,  0xE01, 0x101);
-    define_opcode("SMA", k_operate2,  0xF40, 0x140);
-    define_opcode("SZA", k_operate2,  0xF20, 0x120);
-    define_opcode("SNL", k_operate2,  0xF10, 0x110);
-    define_opcode("RSS", k_operate2,  0xF08, 0x108);
-    define_opcode("OSR", k_operate2,  0xF04, 0x104);
-    define_opcode("HLT", k_operate2,  0xF02, 0x102);
-    define_opcode("NOP", k_operate,   0xE00, 0x1FF);
-    define_opcode("SPA", k_operate2,  0xF48, 0x148);
-    define_opcode("SNA", k_operate2,  0xF28, 0x128);
-    define_opcode("SZL", k_operate2,  0xF18, 0x118);
-    define_opcode("SKP", k_operate2,  0xF08, 0x178);
-    define_opcode("IOT", k_iot,      0xC00, 0x000);
-    define_opcode("ORIG", k_orig,    0x000, 0x000);
-    define_opcode("END", k_end,      0x000, 0x000);
-    define_opcode("I", k_indirect,   0x100, 0x000);
-}
+    /* the table is built by the compiler; all we can do here is
+       check that no two opcodes hashed to the same slot (the later
+       one would silently replace the earlier one). */
+    int i;
+    int n = 0;
+    for (i = 0; i < OPCODE_HASH_SIZE; i++)
+        if (opcode_table[i].name != NULL) n += 1;
 
+    if (n != NUMBER_OF_OPCODES)
+        {
+            fprintf(stderr, "opcode table has %d opcodes, expected %d; check OPCODE_HASH for collisions\n",
+                    n, NUMBER_OF_OPCODES);
+        }
+}
@@ -0,0 +1,413 @@
+/*
+   Assembler for PDP-8.  A peephole optimizer, run over the assembled
+   memory when -O is given.
+
+   It makes three kinds of change, each only where it cannot change
+   what the program does:
+
+   . two operate (group 1) instructions in a row become one, if the
+     one does just what the two did -- CLA followed by IAC is CLA IAC,
+     and CLA CLA is CLA.  Whether they do is found by trying both on
+     every value of the link and accumulator.
+
+   . a NOP (including the one left by merging two instructions) is
+     taken out, and the rest of its page moved down a word.
+
+   . a JMP to a JMP goes straight to where the second one goes.
+
+   Some things that look wasteful are not.  DCA X followed by TAD X
+   stores the accumulator and then gets it back, since DCA clears it;
+   there is no instruction that stores without clearing, so the pair
+   is already the shortest way to do that, and X is still needed.  We
+   leave those alone.
+
+   To know what is safe, we need to know which words are instructions,
+   which are addresses and which are just numbers (a->word_kind), and
+   everything that refers to a word: labels, memory references, and
+   the words that hold addresses.  A number might be an address too,
+   so no word whose address appears as a number anywhere is moved.
+*/
+
+#include "asm8.h"
+#include "symbol.h"
+#include "objmem.h"
+#include "optimize.h"
+
+#define NOP_INSTRUCTION 0xE00
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* decoding instructions */
+
+Boolean is_memory_reference(INST inst)
+{
+    return((inst & 0xE00) < 0xC00);
+}
+
+Boolean is_jump(INST inst)
+{
+    return((inst & 0xE00) == 0xA00);
+}
+
+Boolean is_operate1(INST inst)
+{
+    return((inst & 0xF00) == 0xE00);
+}
+
+/* the word a memory reference at pc refers to (before any indirection) */
+Address operand_address(Address pc, INST inst)
+{
+    Address page = (inst & 0x080) ? (pc & 0xF80) : 0;
+    return(page | (inst & 0x07F));
+}
+
+/* can it skip the next word? */
+Boolean may_skip(INST inst)
+{
+    if ((inst & 0xE00) == 0x400) return(TRUE);                 /* ISZ */
+    if ((inst & 0xE00) == 0xC00) return(TRUE);                 /* IOT: up to the device */
+    if ((inst & 0xF01) == 0xF00) return((inst & 0x078) != 0);  /* group 2 skips */
+    if ((inst & 0xF01) == 0xF01) return(TRUE);                 /* group 3: not ours to say */
+    return(FALSE);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* What a group 1 operate instruction does to the link and the
+   accumulator (as one 13-bit value), in the order the machine does
+   it: clear, complement, increment, rotate. */
+
+int operate1(INST inst, int lac)
+{
+    if (inst & 0x080) lac = lac & 0x1000;               /* CLA */
+    if (inst & 0x040) lac = lac & 0x0FFF;               /* CLL */
+    if (inst & 0x020) lac = lac ^ 0x0FFF;               /* CMA */
+    if (inst & 0x010) lac = lac ^ 0x1000;               /* CML */
+    if (inst & 0x001) lac = (lac + 1) & 0x1FFF;         /* IAC */
+
+    int n = (inst & 0x002) ? 2 : 1;
+    while (n-- > 0)
+        {
+            if (inst & 0x008)                           /* RAR */
+                lac = (lac >> 1) | ((lac & 1) << 12);
+            else if (inst & 0x004)                      /* RAL */
+                lac = ((lac << 1) & 0x1FFF) | (lac >> 12);
+        }
+    return(lac);
+}
+
+/* can x followed by y be one instruction?  Never one the assembler
+   would refuse (RAR RAL), nor 0x002 without a rotate, which is a
+   byte swap on some machines and nothing on others. */
+Boolean combine_operate1(INST x, INST y, INST *xy)
+{
+    INST c = x | y;
+    if ((c & 0x00C) == 0x00C) return(FALSE);
+    if (((x & 0x00E) == 0x002) || ((y & 0x00E) == 0x002) || ((c & 0x00E) == 0x002))
+        return(FALSE);
+
+    int lac;
+    for (lac = 0; lac < 0x2000; lac++)
+        if (operate1(c, lac) != operate1(y, operate1(x, lac)))
+            return(FALSE);
+    *xy = c;
+    return(TRUE);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* Everything that refers to each word of memory.  These are found
+   again after every change; it is a small machine. */
+
+struct word_uses
+{
+    Boolean target[4096];       /* labelled, or referred to in any way */
+    Boolean data_use[4096];     /* may be read or written, not just run */
+    Boolean constant[4096];     /* its address appears as a number */
+    Boolean linked[4096];       /* the linker fills in its operand */
+};
+
+void find_uses(Assembly *a, struct word_uses *u)
+{
+    memset(u, 0, sizeof(struct word_uses));
+
+    int i;
+    for (i = 0; i < a->number_of_fixups; i++)
+        {
+            struct fixup *f = &a->fixups[i];
+            if ((f->sy != NULL) && f->sy->external && !f->full) u->linked[f->addr] = TRUE;
+        }
+
+    Address addr;
+    for (addr = Next_Defined(a, 0, TRUE); addr < 4096; addr = Next_Defined(a, addr + 1, TRUE))
+        {
+            INST w = a->memory[addr];
+            Address x = w & 0xFFF;
+            switch (a->word_kind[addr])
+                {
+                case WORD_INSTRUCTION:
+                    if (!is_memory_reference(w) || u->linked[addr]) break;
+                    x = operand_address(addr, w);
+                    u->target[x] = TRUE;
+                    /* JMP I reads its pointer; only a direct JMP just goes there */
+                    if (!is_jump(w) || (w & 0x100)) u->data_use[x] = TRUE;
+                    break;
+
+                case WORD_ADDRESS:
+                    u->target[x] = TRUE;
+                    u->data_use[x] = TRUE;
+                    break;
+
+                default:
+                    u->target[x] = TRUE;
+                    u->data_use[x] = TRUE;
+                    u->constant[x] = TRUE;
+                    break;
+                }
+        }
+
+    symbol *s;
+    for (s = a->Root_ST; s != NULL; s = s->next)
+        if (s->defined && !s->external) u->target[s->value & 0xFFF] = TRUE;
+    if (a->entry_given && (a->entry_symbol == NULL))
+        u->target[a->entry_point & 0xFFF] = TRUE;
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* Taking out the word at n moves the words after it on its page, up
+   to the end of their run (e), down one.  Anything that refers to
+   them must follow them. */
+
+Address moved(Address x, Address n, Address e)
+{
+    if ((x > n) && (x <= e)) return(x - 1);
+    return(x);
+}
+
+/* can the NOP at n be taken out?  If so, where does its run end? */
+Boolean removable(Assembly *a, struct word_uses *u, Address n, Address *end)
+{
+    /* page zero is shared with other modules, and has the
+       auto-index registers; leave it be */
+    if ((n & 0xF80) == 0) return(FALSE);
+    if (!Is_Defined(a, n) || (a->word_kind[n] != WORD_INSTRUCTION)) return(FALSE);
+    if ((a->memory[n] != NOP_INSTRUCTION) || u->data_use[n]) return(FALSE);
+
+    /* something skips it, and would skip the next one instead */
+    if (Is_Defined(a, n-1) && may_skip(a->memory[n-1])) return(FALSE);
+
+    Address page_end = n | 0x07F;
+    Address e = n;
+    while ((e < page_end) && Is_Defined(a, e+1))
+        e += 1;
+
+    /* there must be something after it to run */
+    if (e == n) return(FALSE);
+
+    /* the run goes on onto the next page: whatever went from the end of
+       this page to the start of the next would now go to an empty word */
+    if ((e == page_end) && (e < 4095) && Is_Defined(a, e+1))
+        {
+            if ((a->word_kind[e] == WORD_INSTRUCTION) && !is_jump(a->memory[e])) return(FALSE);
+            if ((a->word_kind[e-1] == WORD_INSTRUCTION) && may_skip(a->memory[e-1])) return(FALSE);
+        }
+
+    Address x;
+    for (x = n + 1; x <= e; x++)
+        if (u->constant[x]) return(FALSE);
+
+    *end = e;
+    return(TRUE);
+}
+
+void remove_word(Assembly *a, struct word_uses *u, Address n, Address e)
+{
+    Address addr;
+    for (addr = Next_Defined(a, 0, TRUE); addr < 4096; addr = Next_Defined(a, addr + 1, TRUE))
+        {
+            INST w = a->memory[addr];
+            if ((a->word_kind[addr] == WORD_INSTRUCTION) && is_memory_reference(w) && !u->linked[addr])
+                {
+                    Address x = operand_address(addr, w);
+                    a->memory[addr] = (w & ~0x07F) | (moved(x, n, e) & 0x07F);
+                }
+            else if (a->word_kind[addr] == WORD_ADDRESS)
+                a->memory[addr] = moved(w & 0xFFF, n, e);
+        }
+
+    symbol *s;
+    for (s = a->Root_ST; s != NULL; s = s->next)
+        if (s->defined && !s->external) s->value = moved(s->value, n, e);
+    if (a->entry_given && (a->entry_symbol == NULL))
+        a->entry_point = moved(a->entry_point, n, e);
+
+    int i;
+    for (i = 0; i < a->number_of_fixups; i++)
+        a->fixups[i].addr = moved(a->fixups[i].addr, n, e);
+
+    for (addr = n; addr < e; addr++)
+        {
+            a->memory[addr] = a->memory[addr+1];
+            a->word_kind[addr] = a->word_kind[addr+1];
+        }
+    Undefine_Object_Code(a, e);
+    a->word_kind[e] = WORD_DATA;
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* the operate instructions at p and p+1 made one; the NOP this
+   leaves must come out, or nothing is saved */
+Boolean merge_operates(Assembly *a, struct word_uses *u, Address p)
+{
+    Address q = p + 1;
+    if ((q & 0x07F) == 0) return(FALSE);
+    if (!Is_Defined(a, p) || !Is_Defined(a, q)) return(FALSE);
+    if ((a->word_kind[p] != WORD_INSTRUCTION) || (a->word_kind[q] != WORD_INSTRUCTION)) return(FALSE);
+
+    INST x = a->memory[p];
+    INST y = a->memory[q];
+    if (!is_operate1(x) || !is_operate1(y)) return(FALSE);
+
+    /* anything that goes to the second, or changes either, or skips
+       the first, needs them both */
+    if (u->target[q] || u->data_use[p]) return(FALSE);
+    if ((p > 0) && Is_Defined(a, p-1) && may_skip(a->memory[p-1])) return(FALSE);
+
+    INST xy;
+    if (!combine_operate1(x, y, &xy)) return(FALSE);
+
+    a->memory[p] = xy;
+    a->memory[q] = NOP_INSTRUCTION;
+    Address e;
+    if (!removable(a, u, q, &e))
+        {
+            a->memory[p] = x;
+            a->memory[q] = y;
+            return(FALSE);
+        }
+    if (a->debug) fprintf(a->errors, "merged 0x%03X and 0x%03X at 0x%03X\n", x, y, p);
+    remove_word(a, u, q, e);
+    return(TRUE);
+}
+
+
+/* A JMP to a JMP goes where the second one goes, if it can reach it.
+   The jumps we go through must be ones nothing changes as the program
+   runs (a JMS, say, writes its return address over the first word of
+   a subroutine).  Returns the number of jumps skipped. */
+int thread_jump(Assembly *a, struct word_uses *u, Address pc)
+{
+    INST inst = a->memory[pc];
+    if ((a->word_kind[pc] != WORD_INSTRUCTION) || u->linked[pc] || u->data_use[pc]) return(0);
+    if (!is_jump(inst) || (inst & 0x100)) return(0);
+
+    INST best = inst;
+    int hops = 0;
+    Address at = operand_address(pc, inst);
+    while (hops < 16)
+        {
+            if (!Is_Defined(a, at) || (a->word_kind[at] != WORD_INSTRUCTION)) break;
+            if (u->linked[at] || u->data_use[at]) break;
+            INST j = a->memory[at];
+            if (!is_jump(j)) break;
+
+            Address next = operand_address(at, j);
+            if ((next == at) || (next == pc)) break;
+
+            /* only page zero and its own page can be reached from pc */
+            Address page = next & 0xF80;
+            if ((page != 0) && (page != (pc & 0xF80))) break;
+
+            hops += 1;
+            best = 0xA00 | (j & 0x100) | (page != 0 ? 0x080 : 0) | (next & 0x07F);
+
+            /* JMP I: we can go to the pointer, but no further */
+            if (j & 0x100) break;
+            at = next;
+        }
+
+    if (hops > 0)
+        {
+            if (a->debug) fprintf(a->errors, "jump at 0x%03X: 0x%03X now 0x%03X\n", pc, inst, best);
+            a->memory[pc] = best;
+        }
+    return(hops);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+void Optimize_Object_Code(Assembly *a, struct optimize_stats *stats)
+{
+    memset(stats, 0, sizeof(struct optimize_stats));
+    struct word_uses *u = TYPED_MALLOC(struct word_uses);
+
+    /* after a change, the same word may go with the one now after it */
+    find_uses(a, u);
+    Address addr = 0;
+    while (addr < 4096)
+        {
+            Address e;
+            if (merge_operates(a, u, addr))
+                {
+                    stats->merged += 1;
+                    stats->cycles += 1;
+                    find_uses(a, u);
+                }
+            else if (removable(a, u, addr, &e))
+                {
+                    if (a->debug) fprintf(a->errors, "NOP removed at 0x%03X\n", addr);
+                    remove_word(a, u, addr, e);
+                    stats->removed += 1;
+                    stats->cycles += 1;
+                    find_uses(a, u);
+                }
+            else
+                addr += 1;
+        }
+
+    /* jumps last: they do not move anything */
+    find_uses(a, u);
+    for (addr = Next_Defined(a, 0, TRUE); addr < 4096; addr = Next_Defined(a, addr + 1, TRUE))
+        {
+            int hops = thread_jump(a, u, addr);
+            if (hops > 0)
+                {
+                    stats->threaded += 1;
+                    stats->cycles += hops;
+                }
+        }
+
+    free(u);
+}
+
+void Report_Optimization(Assembly *a, struct optimize_stats *stats)
+{
+    if (!a->listing) return;
+    fprintf(a->listing_file, "\nOptimized: %d operate pairs merged, %d NOPs removed, %d jumps threaded; "
+            "%d cycles saved\n", stats->merged, stats->removed, stats->threaded, stats->cycles);
+}
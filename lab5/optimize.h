@@ -0,0 +1,26 @@
+/*
+   Assembler for PDP-8.  The peephole optimizer (-O).
+*/
+
+#ifndef _OPTIMIZE_H_
+#define _OPTIMIZE_H_
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* what the optimizer did, for the listing */
+struct optimize_stats
+{
+    int merged;                 /* pairs of operate instructions made one */
+    int removed;                /* NOPs taken out */
+    int threaded;               /* jumps to jumps, sent straight on */
+    int cycles;                 /* memory cycles saved, each time through */
+};
+
+/* prototypes */
+void Optimize_Object_Code(Assembly *a, struct optimize_stats *stats);
+void Report_Optimization(Assembly *a, struct optimize_stats *stats);
+
+#endif
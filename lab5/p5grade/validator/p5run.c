@@ -0,0 +1,322 @@
+/*
+  p5run -- the p5grade test cases, run in parallel.
+
+  Assembles each .asm file in cases with ./asm8 (from a copy in
+  tmpdir, as test.sh does), several at a time, and checks each object
+  file against its reference image (the .out file in cases, in hex)
+  the same way the validator does, but without starting a validator
+  for each one.  Prints each case with the time it took, in the order
+  of the cases.
+
+  usage: validator/p5run [-j threads] [-l ms] [-p program]
+
+  -j  how many cases to run at once (default: the number of CPUs)
+  -l  a case that takes more than this many milliseconds fails, so
+      a slower assembler is caught as well as a wrong one
+  -p  the assembler to run (default ./asm8)
+
+  The exit status is the number of cases that failed.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <glob.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "../../obj8read.h"
+
+#define CASEDIR "cases"
+#define TMPDIR  "tmpdir"
+#define TIMEOUT 15              /* seconds, as in tf.sh */
+#define MAX_DIFFS 4             /* ranges of differences reported */
+
+typedef short Boolean;
+#define TRUE 1
+#define FALSE 0
+
+typedef char *STRING;
+
+#define CAST(t,e) ((t)(e))
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+STRING program = CAST(STRING, "./asm8");
+int number_of_threads = 0;
+long slow_limit = 0;            /* milliseconds; 0 for none */
+
+struct test_case
+{
+    char   *name;               /* without the directory or .asm */
+    Boolean passed;
+    double  elapsed;            /* milliseconds, wall clock */
+    double  cpu;                /* milliseconds, user + system */
+    char    message[1024];
+};
+
+struct test_case *cases = NULL;
+int number_of_cases = 0;
+
+pthread_mutex_t case_lock = PTHREAD_MUTEX_INITIALIZER;
+int next_case = 0;
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+Boolean copy_file(const char *from, const char *to)
+{
+    FILE *in = fopen(from, "r");
+    if (in == NULL) return(FALSE);
+    FILE *out = fopen(to, "w");
+    if (out == NULL)
+        {
+            fclose(in);
+            return(FALSE);
+        }
+    char buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+        fwrite(buffer, 1, n, out);
+    fclose(in);
+    fclose(out);
+    return(TRUE);
+}
+
+double milliseconds(struct timespec *from, struct timespec *to)
+{
+    return((to->tv_sec - from->tv_sec) * 1000.0 + (to->tv_nsec - from->tv_nsec) / 1000000.0);
+}
+
+/* compare what the assembler wrote with the reference */
+void check_output(struct test_case *c, const char *output, const char *reference)
+{
+    /* both images are too big for a thread's stack */
+    struct obj8_image *o = CAST(struct obj8_image *, malloc(sizeof(struct obj8_image)));
+    struct obj8_image *r = CAST(struct obj8_image *, malloc(sizeof(struct obj8_image)));
+
+    int error = Read_OBJ8_File(output, o);
+    if (error != OBJ8_OK)
+        {
+            snprintf(c->message, sizeof(c->message), "%s: %s", output, OBJ8_Error_Message(error));
+            goto done;
+        }
+    error = Read_OBJ8_Hex_File(reference, r);
+    if (error != OBJ8_OK)
+        {
+            snprintf(c->message, sizeof(c->message), "%s: %s", reference, OBJ8_Error_Message(error));
+            goto done;
+        }
+
+    struct obj8_range ranges[MAX_DIFFS];
+    int n = Diff_OBJ8_Images(o, r, ranges, MAX_DIFFS);
+    if (n > 0)
+        {
+            int length = snprintf(c->message, sizeof(c->message), "%d ranges differ:", n);
+            int i;
+            for (i = 0; (i < n) && (i < MAX_DIFFS) && (length < (int)sizeof(c->message)); i++)
+                length += snprintf(&c->message[length], sizeof(c->message) - length,
+                                   " %03X-%03X (0x%03X, should be 0x%03X)", ranges[i].first, ranges[i].last,
+                                   o->memory[ranges[i].first], r->memory[ranges[i].first]);
+            goto done;
+        }
+    if (o->entry_point != r->entry_point)
+        {
+            snprintf(c->message, sizeof(c->message), "entry point 0x%03X, should be 0x%03X",
+                     o->entry_point, r->entry_point);
+            goto done;
+        }
+    c->passed = TRUE;
+
+ done:
+    free(o);
+    free(r);
+}
+
+void run_case(struct test_case *c)
+{
+    char source[256], copy[256], output[256], log[256], reference[256];
+    snprintf(source, sizeof(source), "%s/%s.asm", CASEDIR, c->name);
+    snprintf(reference, sizeof(reference), "%s/%s.out", CASEDIR, c->name);
+    snprintf(copy, sizeof(copy), "%s/%s.asm", TMPDIR, c->name);
+    snprintf(output, sizeof(output), "%s/%s.out", TMPDIR, c->name);
+    snprintf(log, sizeof(log), "%s/%s.log", TMPDIR, c->name);
+
+    if (!copy_file(source, copy))
+        {
+            snprintf(c->message, sizeof(c->message), "can't copy %s", source);
+            return;
+        }
+    unlink(output);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = fork();
+    if (pid == 0)
+        {
+            /* the assembler's listing and messages go to the log */
+            int fd = open(log, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd >= 0)
+                {
+                    dup2(fd, 1);
+                    dup2(fd, 2);
+                    close(fd);
+                }
+            alarm(TIMEOUT);
+            execl(program, program, copy, (char *)NULL);
+            _exit(127);
+        }
+    if (pid < 0)
+        {
+            snprintf(c->message, sizeof(c->message), "can't run %s: %s", program, strerror(errno));
+            return;
+        }
+
+    int status;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    wait4(pid, &status, 0, &usage);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    c->elapsed = milliseconds(&start, &end);
+    c->cpu = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0
+        + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+
+    if (WIFSIGNALED(status))
+        {
+            if (WTERMSIG(status) == SIGALRM)
+                snprintf(c->message, sizeof(c->message), "TIME LIMIT EXCEEDED");
+            else
+                snprintf(c->message, sizeof(c->message), "killed by signal %d", WTERMSIG(status));
+            return;
+        }
+    if (WIFEXITED(status) && (WEXITSTATUS(status) == 127))
+        {
+            snprintf(c->message, sizeof(c->message), "can't run %s", program);
+            return;
+        }
+
+    check_output(c, output, reference);
+
+    if (c->passed && (slow_limit > 0) && (c->elapsed > slow_limit))
+        {
+            c->passed = FALSE;
+            snprintf(c->message, sizeof(c->message), "too slow: more than %ld ms", slow_limit);
+        }
+}
+
+void *test_thread(void *arg)
+{
+    while (TRUE)
+        {
+            pthread_mutex_lock(&case_lock);
+            int i = next_case;
+            if (i < number_of_cases) next_case += 1;
+            pthread_mutex_unlock(&case_lock);
+            if (i >= number_of_cases) break;
+            run_case(&cases[i]);
+        }
+    return(NULL);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+void usage(void)
+{
+    fprintf(stderr, "usage: p5run [-j threads] [-l ms] [-p program]\n");
+    exit(255);
+}
+
+int main(int argc, STRING *argv)
+{
+    int i;
+    for (i = 1; i < argc; i++)
+        {
+            if ((strcmp(argv[i], "-j") == 0) && (i + 1 < argc))
+                number_of_threads = atoi(argv[++i]);
+            else if ((strcmp(argv[i], "-l") == 0) && (i + 1 < argc))
+                slow_limit = atol(argv[++i]);
+            else if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc))
+                program = argv[++i];
+            else
+                usage();
+        }
+    if (number_of_threads <= 0)
+        number_of_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (number_of_threads <= 0)
+        number_of_threads = 1;
+
+    if (access(program, X_OK) != 0)
+        {
+            fprintf(stderr, "Could not find %s. Compile source and place output in this directory.\n", program);
+            exit(255);
+        }
+    mkdir(TMPDIR, 0755);
+
+    glob_t found;
+    if (glob(CASEDIR "/*.asm", 0, NULL, &found) != 0)
+        {
+            fprintf(stderr, "No test cases in %s\n", CASEDIR);
+            exit(255);
+        }
+    number_of_cases = found.gl_pathc;
+    cases = CAST(struct test_case *, calloc(number_of_cases, sizeof(struct test_case)));
+    for (i = 0; i < number_of_cases; i++)
+        {
+            char *name = found.gl_pathv[i] + strlen(CASEDIR "/");
+            cases[i].name = strndup(name, strlen(name) - strlen(".asm"));
+        }
+    globfree(&found);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int n = (number_of_threads < number_of_cases) ? number_of_threads : number_of_cases;
+    pthread_t *threads = CAST(pthread_t *, malloc(n * sizeof(pthread_t)));
+    int started = 0;
+    while ((started < n) && (pthread_create(&threads[started], NULL, test_thread, NULL) == 0))
+        started += 1;
+    if (started == 0)
+        test_thread(NULL);
+    for (i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    int failed = 0;
+    double total = 0;
+    for (i = 0; i < number_of_cases; i++)
+        {
+            struct test_case *c = &cases[i];
+            total += c->elapsed;
+            printf("%-28s %8.1f ms %8.1f ms cpu  %s", c->name, c->elapsed, c->cpu, c->passed ? "PASS" : "FAIL");
+            if (!c->passed)
+                {
+                    printf(": %s", c->message);
+                    failed += 1;
+                }
+            printf("\n");
+            free(c->name);
+        }
+    free(cases);
+
+    printf("%d OUT OF %d TEST(S) PASSED in %.1f ms (%.1f ms one at a time, %d threads)\n",
+           number_of_cases - failed, number_of_cases, milliseconds(&start, &end), total, started);
+    exit(failed > 254 ? 254 : failed);
+}
@@ -0,0 +1,294 @@
+/*
+   Assembler for PDP-8.  Relocatable modules: writing them (asm8 -r)
+   and reading them (link8).  The format is described in reloc.h.
+*/
+
+#include "asm8.h"
+#include "error.h"
+#include "input.h"
+#include "symbol.h"
+#include "objmem.h"
+#include "reloc.h"
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* page zero is not moved by the linker; anything else is */
+Boolean relocatable_address(Address addr)
+{
+    return((addr & 0xF80) != 0);
+}
+
+void put_rel_word(Assembly *a, Address n)
+{
+    char twoByte[2];
+    splitIntoTwoBytes(n, twoByte);
+    fwrite(twoByte, 1, 2, a->output);
+}
+
+void put_rel_name(Assembly *a, const char *name)
+{
+    int length = strlen(name);
+    if (length > 255) length = 255;
+    fputc(length, a->output);
+    fwrite(name, 1, length, a->output);
+}
+
+void Output_Relocatable_Code(Assembly *a)
+{
+    fputs(REL_MAGIC, a->output);
+
+    /* the code, in runs that do not cross a page */
+    int i = Next_Defined(a, 0, TRUE);
+    while (i < 4096)
+        {
+            /* to the end of the run, or of the page */
+            int j = Next_Defined(a, i, FALSE);
+            if (j > (i | (PAGE_SIZE - 1)) + 1) j = (i | (PAGE_SIZE - 1)) + 1;
+
+            fputc('S', a->output);
+            put_rel_word(a, i);
+            fputc(j - i, a->output);
+            for (; i < j; i++)
+                put_rel_word(a, a->memory[i]);
+            i = Next_Defined(a, j, TRUE);
+        }
+
+    /* the symbols: EXTERN symbols are numbered as we go */
+    int number_of_externals = 0;
+    symbol *s;
+    for (s = a->Root_ST; s != NULL; s = s->next)
+        {
+            if (s->external)
+                {
+                    if (s->global)
+                        {
+                            Report_Error(a, 0, "symbol %s is both GLOBAL and EXTERN", s->name);
+                        }
+                    s->number = number_of_externals;
+                    number_of_externals += 1;
+                    fputc('N', a->output);
+                    put_rel_name(a, s->name);
+                }
+            else if (s->global && s->defined)
+                {
+                    fputc('G', a->output);
+                    put_rel_word(a, s->value);
+                    fputc(relocatable_address(s->value) ? REL_RELOCATABLE : 0, a->output);
+                    put_rel_name(a, s->name);
+                }
+        }
+
+    /* what the linker has to fix */
+    for (i = 0; i < a->number_of_fixups; i++)
+        {
+            struct fixup *f = &a->fixups[i];
+            if (f->expression != NULL)
+                {
+                    if (f->full && f->relocate)
+                        {
+                            fputc('R', a->output);
+                            put_rel_word(a, f->addr);
+                        }
+                }
+            else if (f->sy->external)
+                {
+                    fputc('U', a->output);
+                    put_rel_word(a, f->addr);
+                    fputc(f->full ? 'F' : 'M', a->output);
+                    put_rel_word(a, f->sy->number);
+                }
+            else if (f->full && f->sy->defined && relocatable_address(f->sy->value))
+                {
+                    fputc('R', a->output);
+                    put_rel_word(a, f->addr);
+                }
+        }
+
+    /* and where to start */
+    if (a->entry_symbol != NULL)
+        {
+            s = a->entry_symbol;
+            if (s->external)
+                {
+                    Report_Error(a, 0, "entry point %s may not be EXTERN", s->name);
+                }
+            else if (s->defined)
+                {
+                    fputc('E', a->output);
+                    put_rel_word(a, s->value);
+                    fputc(relocatable_address(s->value) ? REL_RELOCATABLE : 0, a->output);
+                }
+        }
+    else if (a->entry_given)
+        {
+            fputc('E', a->output);
+            put_rel_word(a, a->entry_point);
+            fputc(0, a->output);
+        }
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* Reading a module: the whole file is read at once, and then taken
+   apart.  Anything that runs past the end, or makes no sense, and
+   the module is rejected. */
+
+struct rel_input
+{
+    const unsigned char *p;
+    const unsigned char *end;
+    Boolean ok;
+};
+
+int get_rel_byte(struct rel_input *in)
+{
+    if (in->p >= in->end)
+        {
+            in->ok = FALSE;
+            return(0);
+        }
+    return(*in->p++);
+}
+
+Address get_rel_word(struct rel_input *in)
+{
+    int high = get_rel_byte(in);
+    int low = get_rel_byte(in);
+    if ((high > 0x3F) || (low > 0x3F)) in->ok = FALSE;
+    return(((high & 0x3F) << 6) | (low & 0x3F));
+}
+
+char *get_rel_name(struct rel_input *in)
+{
+    int length = get_rel_byte(in);
+    if (in->end - in->p < length)
+        {
+            in->ok = FALSE;
+            length = 0;
+        }
+    char *name = CAST(char *, malloc(length + 1));
+    memcpy(name, in->p, length);
+    name[length] = '\0';
+    in->p += length;
+    return(name);
+}
+
+/* make room for one more in a growing array */
+void *grow(void *array, int count, size_t size)
+{
+    if ((count & (count - 1)) == 0)
+        array = realloc(array, (count == 0 ? 8 : 2*count) * size);
+    return(array);
+}
+
+Boolean Read_Module(const char *name, struct module *m, FILE *errors)
+{
+    memset(m, 0, sizeof(struct module));
+    m->name = strdup(name);
+
+    FILE *f = fopen(name, "r");
+    if (f == NULL)
+        {
+            fprintf(errors, "Can't open %s\n", name);
+            return(FALSE);
+        }
+    long n;
+    unsigned char *data = CAST(unsigned char *, read_all(f, &n));
+    fclose(f);
+
+    struct rel_input in;
+    in.p = data;
+    in.end = data + n;
+    in.ok = (n >= 4) && (memcmp(data, REL_MAGIC, 4) == 0);
+    if (in.ok) in.p += 4;
+
+    while (in.ok && (in.p < in.end))
+        {
+            int type = get_rel_byte(&in);
+            switch (type)
+                {
+                case 'S':
+                    {
+                        Address addr = get_rel_word(&in);
+                        int count = get_rel_byte(&in);
+                        if ((addr % PAGE_SIZE) + count > PAGE_SIZE) in.ok = FALSE;
+                        while (in.ok && (count-- > 0))
+                            {
+                                m->memory[addr] = get_rel_word(&in);
+                                m->defined[addr] = TRUE;
+                                addr += 1;
+                            }
+                        break;
+                    }
+
+                case 'N':
+                    m->externals = CAST(char **, grow(m->externals, m->number_of_externals, sizeof(char *)));
+                    m->externals[m->number_of_externals++] = get_rel_name(&in);
+                    break;
+
+                case 'G':
+                    {
+                        m->globals = CAST(struct rel_global *, grow(m->globals, m->number_of_globals, sizeof(struct rel_global)));
+                        struct rel_global *g = &m->globals[m->number_of_globals++];
+                        g->value = get_rel_word(&in);
+                        g->relocatable = (get_rel_byte(&in) & REL_RELOCATABLE) != 0;
+                        g->name = get_rel_name(&in);
+                        break;
+                    }
+
+                case 'R':
+                    m->relocate[get_rel_word(&in)] = TRUE;
+                    break;
+
+                case 'U':
+                    {
+                        m->uses = CAST(struct rel_use *, grow(m->uses, m->number_of_uses, sizeof(struct rel_use)));
+                        struct rel_use *u = &m->uses[m->number_of_uses++];
+                        u->addr = get_rel_word(&in);
+                        u->how = get_rel_byte(&in);
+                        u->number = get_rel_word(&in);
+                        if (((u->how != 'F') && (u->how != 'M'))
+                            || (u->number >= m->number_of_externals))
+                            in.ok = FALSE;
+                        break;
+                    }
+
+                case 'E':
+                    m->has_entry = TRUE;
+                    m->entry = get_rel_word(&in);
+                    m->entry_relocatable = (get_rel_byte(&in) & REL_RELOCATABLE) != 0;
+                    break;
+
+                default:
+                    in.ok = FALSE;
+                    break;
+                }
+        }
+    free(data);
+
+    if (!in.ok)
+        fprintf(errors, "%s is not a relocatable PDP-8 module\n", name);
+    return(in.ok);
+}
+
+void Free_Module(struct module *m)
+{
+    int i;
+    for (i = 0; i < m->number_of_externals; i++)
+        free(m->externals[i]);
+    for (i = 0; i < m->number_of_globals; i++)
+        free(m->globals[i].name);
+    if (m->externals != NULL) free(m->externals);
+    if (m->globals != NULL) free(m->globals);
+    if (m->uses != NULL) free(m->uses);
+    if (m->name != NULL) free(m->name);
+    memset(m, 0, sizeof(struct module));
+}
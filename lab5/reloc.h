@@ -0,0 +1,91 @@
+/*
+   Assembler for PDP-8.  Relocatable modules, for the linker (link8).
+*/
+
+#ifndef _RELOC_H_
+#define _RELOC_H_
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* With -r, the assembler writes a relocatable module (.rel) instead
+   of an OBJ8 file.  A PDP-8 memory reference reaches only page zero
+   and its own page, so a module can only be moved a page at a time:
+   the linker gives each page of a module (other than page zero) a
+   new page, and page zero stays where it is, shared by everyone.
+
+   Words and addresses are two bytes, 6 bits each, as in OBJ8; other
+   numbers are one byte.  After "REL8", a module is a list of records,
+   each starting with its type:
+
+      'S' address count words   code: count words, all on one page
+      'N' length name           an EXTERN symbol; numbered from 0
+      'G' value flags length name
+                                a GLOBAL symbol defined here
+      'R' address               the word at address is an address in
+                                this module
+      'U' address how number    the word at address uses EXTERN symbol
+                                number: all of it (how = 'F'), or as
+                                a memory reference (how = 'M'), which
+                                must then be on page zero
+      'E' value flags           the entry point
+
+   A direct memory reference to an EXTERN symbol (JMS SUB) is made
+   indirect, through a link on its page, so only the link ('U' 'F')
+   is left to the linker.
+
+   In flags, REL_RELOCATABLE means value is an address in this module
+   (it is not on page zero); otherwise it is absolute. */
+
+#define REL_MAGIC "REL8"
+#define REL_RELOCATABLE 1
+
+#define PAGE_SIZE 128
+#define NUMBER_OF_PAGES 32
+
+struct rel_global
+{
+    char   *name;
+    Address value;
+    Boolean relocatable;
+};
+
+struct rel_use
+{
+    Address addr;
+    char    how;
+    int     number;
+};
+
+/* a module, as read by the linker */
+struct module
+{
+    STRING  name;
+    INST    memory[4096];
+    Boolean defined[4096];
+    Boolean relocate[4096];     /* 'R': the word holds an address */
+
+    int     number_of_externals;
+    char  **externals;
+    int     number_of_globals;
+    struct rel_global *globals;
+    int     number_of_uses;
+    struct rel_use *uses;
+
+    Boolean has_entry;
+    Address entry;
+    Boolean entry_relocatable;
+
+    int     page_map[NUMBER_OF_PAGES];  /* where the linker put each page */
+};
+
+/* prototypes */
+Boolean relocatable_address(Address addr);
+void Output_Relocatable_Code(Assembly *a);
+
+Boolean Read_Module(const char *name, struct module *m, FILE *errors);
+void Free_Module(struct module *m);
+
+#endif
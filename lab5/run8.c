@@ -0,0 +1,129 @@
+/*
+  run8 -- assemble a PDP-8 program and run it, in one process.
+
+  The program is assembled into memory (Assemble_Buffer, libasm8.h),
+  and that memory is loaded straight into the lab4 simulator
+  (../lab4/pdp8.c): no object file is written, and nothing is
+  converted to text and read back.  The
+  program's output, and with -v its trace, are the same as from
+  asm8, obj8dump and the simulator one after the other.
+
+  usage: run8 [-v] [-O] [-t cycles] file.asm
+
+  -v  trace each instruction on stderr, as the simulator's -v does
+  -O  run the program as the peephole optimizer leaves it
+  -t  stop after this many cycles (for programs that may not halt)
+
+  The exit status is 0 if the program halted, 1 if it could not be
+  assembled, and 2 if it ran out of time.
+*/
+
+#include "asm8.h"
+#include "input.h"
+#include "libasm8.h"
+#include "../lab4/pdp8.h"
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* read all of the source; it may be a pipe (or /dev/stdin) */
+char *read_source(STRING name, long *length)
+{
+    FILE *f = fopen(name, "r");
+    if (f == NULL) return(NULL);
+    char *buffer = read_all(f, length);
+    fclose(f);
+    return(buffer);
+}
+
+/* the words the assembler defined, and the entry point, are what
+   loading its object file would have put in the machine */
+void load_machine(struct asm8_image *image, MachineStatus *m)
+{
+    memset(m, 0, sizeof(MachineStatus));
+    int i;
+    for (i = 0; i < 4096; i++)
+        if (Image_Defined(image, i))
+            m->memory[i] = image->memory[i] & 0xFFF;
+    m->programCounter = image->entry_point;
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+void usage(void)
+{
+    fprintf(stderr, "usage: run8 [-v] [-O] [-t cycles] file.asm\n");
+    exit(1);
+}
+
+int main(int argc, STRING *argv)
+{
+    Boolean verbose = FALSE;
+    Boolean optimize = FALSE;
+    long long limit = 0;
+    STRING name = NULL;
+    int i;
+    for (i = 1; i < argc; i++)
+        {
+            if (strcmp(argv[i], "-v") == 0)
+                verbose = TRUE;
+            else if (strcmp(argv[i], "-O") == 0)
+                optimize = TRUE;
+            else if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+                limit = atoll(argv[++i]);
+            else if ((argv[i][0] != '-') && (name == NULL))
+                name = argv[i];
+            else
+                usage();
+        }
+    if (name == NULL) usage();
+
+    long length;
+    char *source = read_source(name, &length);
+    if (source == NULL)
+        {
+            fprintf(stderr, "Can't open %s\n", name);
+            exit(1);
+        }
+
+    struct asm8_options options;
+    memset(&options, 0, sizeof(options));
+    options.optimize = optimize;
+    options.file_name = name;
+
+    struct asm8_image *image = TYPED_MALLOC(struct asm8_image);
+    Assemble_Buffer(source, length, &options, image);
+    free(source);
+    for (i = 0; i < image->number_of_diagnostics; i++)
+        fprintf(stderr, "%s\n", image->diagnostics[i].message);
+    if (image->number_of_errors > 0)
+        {
+            fprintf(stderr, "*** %d errors in assembly\n", image->number_of_errors);
+            Free_Image(image);
+            free(image);
+            exit(1);
+        }
+
+    MachineStatus *m = TYPED_MALLOC(MachineStatus);
+    load_machine(image, m);
+    Free_Image(image);
+    free(image);
+
+    OutputBuffer output;
+    initOutputBuffer(&output);
+    int halted = runMachine(m, &output, verbose ? stderr : NULL, limit);
+    printf("%s", output.buf);
+    if (!halted)
+        fprintf(stderr, "run8: no halt in %lld cycles\n", limit);
+
+    freeOutputBuffer(&output);
+    free(m);
+    exit(halted ? 0 : 2);
+}
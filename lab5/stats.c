@@ -0,0 +1,98 @@
+/*
+   Assembler for PDP-8.  Statistics (-S).  See stats.h.
+*/
+
+#include <time.h>
+#include "asm8.h"
+#include "objmem.h"
+#include "stats.h"
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+double stats_clock(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return(t.tv_sec + t.tv_nsec / 1e9);
+}
+
+/* collect statistics for this assembly in s, from now on */
+void Start_Statistics(Assembly *a, struct asm_stats *s)
+{
+    memset(s, 0, sizeof(struct asm_stats));
+    s->phase = PHASE_OTHER;
+    s->calls[PHASE_OTHER] = 1;
+    s->started = stats_clock();
+    a->stats = s;
+}
+
+/* charge the time since the last change to the phase that was
+   running, and run p; returns the phase that was running */
+enum stats_phase Switch_Phase(struct asm_stats *s, enum stats_phase p)
+{
+    double now = stats_clock();
+    enum stats_phase old = s->phase;
+    s->seconds[old] += now - s->started;
+    s->started = now;
+    s->phase = p;
+    return(old);
+}
+
+enum stats_phase Enter_Phase(struct asm_stats *s, enum stats_phase p)
+{
+    s->calls[p] += 1;
+    return(Switch_Phase(s, p));
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+const char *phase_names[NUMBER_OF_PHASES] =
+{
+    [PHASE_OTHER] = "other",
+    [PHASE_READ] = "read",
+    [PHASE_TOKENS] = "tokens",
+    [PHASE_SYMBOLS] = "symbols",
+    [PHASE_LISTING] = "listing",
+    [PHASE_RESOLVE] = "resolve",
+    [PHASE_OPTIMIZE] = "optimize",
+    [PHASE_OUTPUT] = "output",
+};
+
+void Report_Statistics(Assembly *a, FILE *f)
+{
+    struct asm_stats *s = a->stats;
+    if (s == NULL) return;
+
+    /* bring the current phase up to date */
+    Switch_Phase(s, s->phase);
+
+    double total_seconds = 0;
+    long total_bytes = 0;
+    int i;
+    for (i = 0; i < NUMBER_OF_PHASES; i++)
+        {
+            total_seconds += s->seconds[i];
+            total_bytes += s->bytes[i];
+        }
+
+    fprintf(f, "Statistics for %s:\n", (a->file_name != NULL) ? a->file_name : "(input)");
+    fprintf(f, "  %-10s %10s %6s %10s %10s\n", "phase", "ms", "%", "calls", "bytes");
+    for (i = 0; i < NUMBER_OF_PHASES; i++)
+        fprintf(f, "  %-10s %10.3f %6.1f %10ld %10ld\n", phase_names[i], s->seconds[i] * 1000,
+                (total_seconds > 0) ? 100 * s->seconds[i] / total_seconds : 0.0,
+                s->calls[i], s->bytes[i]);
+    fprintf(f, "  %-10s %10.3f %6.1f %10s %10ld\n", "total", total_seconds * 1000, 100.0, "", total_bytes);
+
+    fprintf(f, "  %d words of object code\n", Count_Defined(a, 0, 4096));
+    fprintf(f, "  %ld symbols, %ld fixups; %ld searches, %.1f probes each, longest %ld\n",
+            s->symbols, s->fixups, s->searches,
+            (s->searches > 0) ? CAST(double, s->probes) / s->searches : 0.0, s->longest_search);
+}
@@ -0,0 +1,64 @@
+/*
+   Assembler for PDP-8.  Statistics on where an assembly spends its
+   time and memory (-S).
+*/
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* The assembly is always in exactly one phase; the time between two
+   changes of phase is charged to the phase that was running, so
+   nested phases (get_token calling intern_name) are not counted
+   twice.  Each entry to a phase is a call. */
+
+enum stats_phase
+{
+    PHASE_OTHER,                /* parsing the tokens, and the rest */
+    PHASE_READ,                 /* get_next_line: lines, macros, includes */
+    PHASE_TOKENS,               /* get_token */
+    PHASE_SYMBOLS,              /* intern_name, insert_symbol, add_fixup */
+    PHASE_LISTING,              /* finish_this_line */
+    PHASE_RESOLVE,              /* forward references and literals */
+    PHASE_OPTIMIZE,
+    PHASE_OUTPUT,               /* writing the object file */
+    NUMBER_OF_PHASES
+};
+
+struct asm_stats
+{
+    enum stats_phase phase;     /* running now */
+    double started;             /* when it started running, in seconds */
+
+    double seconds[NUMBER_OF_PHASES];
+    long   calls[NUMBER_OF_PHASES];
+    long   bytes[NUMBER_OF_PHASES];   /* allocated, including growth */
+
+    /* the symbol table */
+    long symbols;
+    long searches;
+    long probes;                /* names looked at, in all searches */
+    long longest_search;
+    long fixups;
+};
+
+/* With no -S, a->stats is NULL and each of these is one test. */
+
+#define STATS_ENTER(a, p) \
+    (((a)->stats != NULL) ? Enter_Phase((a)->stats, (p)) : PHASE_OTHER)
+#define STATS_LEAVE(a, saved) \
+    (((a)->stats != NULL) ? (void)Switch_Phase((a)->stats, (saved)) : (void)0)
+#define STATS_ALLOCATED(a, n) \
+    (((a)->stats != NULL) ? (void)((a)->stats->bytes[(a)->stats->phase] += (n)) : (void)0)
+
+/* prototypes */
+void Start_Statistics(Assembly *a, struct asm_stats *s);
+enum stats_phase Switch_Phase(struct asm_stats *s, enum stats_phase p);
+enum stats_phase Enter_Phase(struct asm_stats *s, enum stats_phase p);
+void Report_Statistics(Assembly *a, FILE *f);
+
+#endif
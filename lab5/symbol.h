@@ -10,33 +10,60 @@
 /*                                                                   */
 /* ***************************************************************** */
 
-struct forward_reference_node
-{
-    struct forward_reference_node *next;
-    Address addr;
-    Boolean full;
-    int line_number;
-};
-
-
 struct symbol_table_entry
 {
     struct symbol_table_entry *next;
     char    *name;
     Address  value;
-    struct forward_reference_node *fr;
+    Boolean  defined;
+    Boolean  global;            /* GLOBAL: exported from a relocatable module */
+    Boolean  external;          /* EXTERN: defined in another module */
+    int      number;            /* EXTERN symbols are numbered in the module */
+    int      defining_line;
+    int      defining_file;     /* a->file_number of defining_line */
+    int      reference_line;    /* last forward reference, for errors */
 };
 
 typedef struct symbol_table_entry symbol;
 
+
+/* A use of a symbol before it is defined.  These are kept in one
+   array (a->fixups) and all resolved at the end of the assembly.
+   In a relocatable assembly, every use of a symbol is kept, since
+   the linker may need to change it.  A fixup for an expression has
+   the expression, and sy is one of its symbols, or NULL; whether its
+   value is an address is known once it is resolved. */
+
+struct fixup
+{
+    symbol *sy;
+    const struct expression *expression;   /* if not just sy (expr.h) */
+    Boolean relocate;           /* the expression is an address in the module */
+    Address addr;
+    Boolean full;
+    int line_number;
+    int order;          /* the order they were made in */
+};
+
 /* function prototypes */
 
-symbol *search_symbol(char *name);
+/* names are interned (intern.h) */
+
+struct interned_name;
+
+symbol *search_symbol(Assembly *a, const char *name, int length);
+
+symbol *declare_symbol(Assembly *a, struct interned_name *name, int line_number);
+
+void define_symbol(Assembly *a, struct interned_name *name, Address value);
+
+void forward_reference(Assembly *a, struct interned_name *name, int line_number, Address reference_address, Boolean full);
+void add_fixup(Assembly *a, symbol *s, Address reference_address, Boolean full, int line_number);
 
-void define_symbol(char *name, Address value);
+void Resolve_Forward_References(Assembly *a);
 
-void forward_reference(char *name, int line_number, Address reference_address, Boolean full);
+void Check_for_undefined_symbols(Assembly *a);
 
-void Check_for_undefined_symbols(void);
+void Release_Symbol_Table(Assembly *a);
 
 #endif
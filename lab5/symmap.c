@@ -0,0 +1,278 @@
+/*
+   Assembler for PDP-8.  Symbol map files: writing them (with -M), and
+   reading and searching them, for the tools that want symbols for
+   the addresses in an object file.  The format is in symmap.h.
+*/
+
+#include <sys/stat.h>
+#include "asm8.h"
+#include "symbol.h"
+#include "symmap.h"
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+void map_put2(unsigned char *p, unsigned int n)
+{
+    p[0] = n & 0xFF;
+    p[1] = (n >> 8) & 0xFF;
+}
+
+void map_put4(unsigned char *p, unsigned long n)
+{
+    p[0] = n & 0xFF;
+    p[1] = (n >> 8) & 0xFF;
+    p[2] = (n >> 16) & 0xFF;
+    p[3] = (n >> 24) & 0xFF;
+}
+
+unsigned int map_get2(const unsigned char *p)
+{
+    return(p[0] | (p[1] << 8));
+}
+
+unsigned long map_get4(const unsigned char *p)
+{
+    return(p[0] | (p[1] << 8) | (p[2] << 16) | (CAST(unsigned long, p[3]) << 24));
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+struct map_item
+{
+    symbol *sy;
+    int position;       /* in the address order */
+};
+
+int compare_by_address(const void *p, const void *q)
+{
+    const struct map_item *x = CAST(const struct map_item *, p);
+    const struct map_item *y = CAST(const struct map_item *, q);
+    int d = (x->sy->value & 0xFFF) - (y->sy->value & 0xFFF);
+    if (d != 0) return(d);
+    return(strcasecmp(x->sy->name, y->sy->name));
+}
+
+int compare_by_name(const void *p, const void *q)
+{
+    const struct map_item *x = CAST(const struct map_item *, p);
+    const struct map_item *y = CAST(const struct map_item *, q);
+    return(strcasecmp(x->sy->name, y->sy->name));
+}
+
+void Write_Symbol_Map(Assembly *a, FILE *f)
+{
+    /* the defined symbols */
+    int n = 0;
+    symbol *s;
+    for (s = a->Root_ST; s != NULL; s = s->next)
+        if (s->defined) n += 1;
+
+    struct map_item *items = CAST(struct map_item *, malloc((n + 1) * sizeof(struct map_item)));
+    int i = 0;
+    long names_size = 0;
+    for (s = a->Root_ST; s != NULL; s = s->next)
+        if (s->defined)
+            {
+                items[i++].sy = s;
+                names_size += strlen(s->name) + 1;
+            }
+
+    long size = SYMBOL_MAP_HEADER_SIZE + n*(SYMBOL_MAP_ENTRY_SIZE + 4) + names_size;
+    unsigned char *data = CAST(unsigned char *, malloc(size));
+    memcpy(data, SYMBOL_MAP_MAGIC, 4);
+    map_put4(&data[4], n);
+    map_put4(&data[8], names_size);
+
+    /* the symbols in address order, and their names */
+    if (n > 1) qsort(items, n, sizeof(struct map_item), compare_by_address);
+    unsigned char *entry = &data[SYMBOL_MAP_HEADER_SIZE];
+    unsigned char *by_name = entry + n*SYMBOL_MAP_ENTRY_SIZE;
+    char *names = CAST(char *, by_name + 4*n);
+    long offset = 0;
+    for (i = 0; i < n; i++)
+        {
+            s = items[i].sy;
+            int length = strlen(s->name);
+            map_put4(entry, offset);
+            map_put4(entry + 4, s->defining_line);
+            map_put2(entry + 8, s->value & 0xFFF);
+            map_put2(entry + 10, length);
+            entry += SYMBOL_MAP_ENTRY_SIZE;
+            memcpy(&names[offset], s->name, length + 1);
+            offset += length + 1;
+            items[i].position = i;
+        }
+
+    /* and the index in name order */
+    if (n > 1) qsort(items, n, sizeof(struct map_item), compare_by_name);
+    for (i = 0; i < n; i++)
+        map_put4(&by_name[4*i], items[i].position);
+
+    fwrite(data, 1, size, f);
+    free(data);
+    free(items);
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* Read a map file, and check it all once, so that the searches
+   below can trust it.  Returns NULL if it cannot be read, or is
+   not a symbol map (or not sorted as one is). */
+
+Symbol_Map *Load_Symbol_Map(const char *file_name)
+{
+    FILE *f = fopen(file_name, "r");
+    if (f == NULL) return(NULL);
+
+    struct stat st;
+    if ((fstat(fileno(f), &st) != 0) || (st.st_size < SYMBOL_MAP_HEADER_SIZE))
+        {
+            fclose(f);
+            return(NULL);
+        }
+
+    Symbol_Map *m = TYPED_MALLOC(Symbol_Map);
+    m->size = st.st_size;
+    m->data = CAST(unsigned char *, malloc(m->size + 1));
+    Boolean ok = (m->data != NULL) && (fread(m->data, 1, m->size, f) == m->size);
+    fclose(f);
+
+    if (ok) ok = (memcmp(m->data, SYMBOL_MAP_MAGIC, 4) == 0);
+    if (ok)
+        {
+            unsigned long n = map_get4(&m->data[4]);
+            unsigned long names_size = map_get4(&m->data[8]);
+            ok = (n <= m->size / (SYMBOL_MAP_ENTRY_SIZE + 4)) && (names_size <= m->size)
+                && (m->size == SYMBOL_MAP_HEADER_SIZE + n*(SYMBOL_MAP_ENTRY_SIZE + 4) + names_size);
+            m->number_of_symbols = n;
+            m->names_size = names_size;
+        }
+    if (ok)
+        {
+            m->by_address = &m->data[SYMBOL_MAP_HEADER_SIZE];
+            m->by_name = m->by_address + m->number_of_symbols*SYMBOL_MAP_ENTRY_SIZE;
+            m->names = CAST(const char *, m->by_name + 4*m->number_of_symbols);
+
+            int i;
+            for (i = 0; ok && (i < m->number_of_symbols); i++)
+                {
+                    const unsigned char *e = &m->by_address[i*SYMBOL_MAP_ENTRY_SIZE];
+                    unsigned long offset = map_get4(e);
+                    unsigned int length = map_get2(e + 10);
+                    ok = (offset + length < m->names_size) && (m->names[offset + length] == '\0')
+                        && (map_get2(e + 8) <= 0xFFF)
+                        && (map_get4(&m->by_name[4*i]) < m->number_of_symbols);
+                }
+        }
+
+    /* the searches are binary, so both orders must be right */
+    if (ok)
+        {
+            int i;
+            for (i = 1; ok && (i < m->number_of_symbols); i++)
+                {
+                    struct map_symbol x, y;
+                    Symbol_Map_Entry(m, i - 1, &x);
+                    Symbol_Map_Entry(m, i, &y);
+                    ok = (x.address < y.address)
+                        || ((x.address == y.address) && (strcasecmp(x.name, y.name) <= 0));
+                    Symbol_Map_Entry(m, map_get4(&m->by_name[4*(i - 1)]), &x);
+                    Symbol_Map_Entry(m, map_get4(&m->by_name[4*i]), &y);
+                    if (ok) ok = (strcasecmp(x.name, y.name) <= 0);
+                }
+
+            /* and each symbol is in the index: found by its name */
+            for (i = 0; ok && (i < m->number_of_symbols); i++)
+                {
+                    struct map_symbol x, y;
+                    Symbol_Map_Entry(m, i, &x);
+                    ok = Lookup_Symbol_Map(m, x.name, &y) && (y.address == x.address) && (y.line == x.line);
+                }
+        }
+
+    if (!ok)
+        {
+            Free_Symbol_Map(m);
+            return(NULL);
+        }
+    return(m);
+}
+
+void Free_Symbol_Map(Symbol_Map *m)
+{
+    if (m->data != NULL) free(m->data);
+    free(m);
+}
+
+
+/* the i-th symbol, in address order */
+void Symbol_Map_Entry(Symbol_Map *m, int i, struct map_symbol *s)
+{
+    const unsigned char *e = &m->by_address[i*SYMBOL_MAP_ENTRY_SIZE];
+    s->name = &m->names[map_get4(e)];
+    s->line = map_get4(e + 4);
+    s->address = map_get2(e + 8);
+}
+
+
+/* the symbol for an address: the last one at or before it.  If
+   several are at the same address, the first (by name). */
+Boolean Symbolize_Address(Symbol_Map *m, int address, struct map_symbol *s)
+{
+    /* find the first symbol after the address */
+    int low = 0;
+    int high = m->number_of_symbols;
+    while (low < high)
+        {
+            int mid = (low + high) / 2;
+            if (map_get2(&m->by_address[mid*SYMBOL_MAP_ENTRY_SIZE + 8]) <= address)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+    if (low == 0) return(FALSE);
+
+    /* back up to the first one before it, at that address */
+    int i = low - 1;
+    unsigned int found = map_get2(&m->by_address[i*SYMBOL_MAP_ENTRY_SIZE + 8]);
+    while ((i > 0) && (map_get2(&m->by_address[(i-1)*SYMBOL_MAP_ENTRY_SIZE + 8]) == found))
+        i -= 1;
+    Symbol_Map_Entry(m, i, s);
+    return(TRUE);
+}
+
+
+/* the symbol with this name (case does not matter, as in the source) */
+Boolean Lookup_Symbol_Map(Symbol_Map *m, const char *name, struct map_symbol *s)
+{
+    int low = 0;
+    int high = m->number_of_symbols;
+    while (low < high)
+        {
+            int mid = (low + high) / 2;
+            int i = map_get4(&m->by_name[4*mid]);
+            int c = strcasecmp(name, &m->names[map_get4(&m->by_address[i*SYMBOL_MAP_ENTRY_SIZE])]);
+            if (c == 0)
+                {
+                    Symbol_Map_Entry(m, i, s);
+                    return(TRUE);
+                }
+            if (c < 0)
+                high = mid;
+            else
+                low = mid + 1;
+        }
+    return(FALSE);
+}
@@ -0,0 +1,62 @@
+/*
+   Assembler for PDP-8.  Symbol map files.
+*/
+
+#ifndef _SYMMAP_H_
+#define _SYMMAP_H_
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* A symbol map (.sym) lists every symbol defined by an assembly, with
+   its address and the line that defined it.  It is made to be read
+   in one piece and searched in place; all numbers are little endian.
+
+      "SYM8"
+      number of symbols                       4 bytes
+      size of the names                       4 bytes
+      the symbols, sorted by address (then name), 12 bytes each:
+          offset of the name                  4 bytes
+          defining line                       4 bytes
+          address                             2 bytes
+          length of the name                  2 bytes
+      the symbols again, sorted by name       4 bytes each (an index)
+      the names, each followed by a null
+*/
+
+#define SYMBOL_MAP_MAGIC "SYM8"
+#define SYMBOL_MAP_HEADER_SIZE 12
+#define SYMBOL_MAP_ENTRY_SIZE 12
+
+struct symbol_map
+{
+    unsigned char *data;
+    long  size;
+    int   number_of_symbols;
+    const unsigned char *by_address;
+    const unsigned char *by_name;
+    const char *names;
+    int   names_size;
+};
+typedef struct symbol_map Symbol_Map;
+
+/* one symbol, as found in a map */
+struct map_symbol
+{
+    const char *name;
+    int  line;
+    int  address;
+};
+
+/* prototypes */
+void Write_Symbol_Map(Assembly *a, FILE *f);
+
+Symbol_Map *Load_Symbol_Map(const char *file_name);
+void Free_Symbol_Map(Symbol_Map *m);
+void Symbol_Map_Entry(Symbol_Map *m, int i, struct map_symbol *s);
+Boolean Symbolize_Address(Symbol_Map *m, int address, struct map_symbol *s);
+Boolean Lookup_Symbol_Map(Symbol_Map *m, const char *name, struct map_symbol *s);
+
+#endif
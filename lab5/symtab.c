@@ -3,8 +3,14 @@
 */
 
 #include "asm8.h"
+#include "error.h"
 #include "symbol.h"
 #include "objmem.h"
+#include "arena.h"
+#include "literal.h"
+#include "stats.h"
+#include "expr.h"
+#include "intern.h"
 
 
 /* ***************************************************************** */
@@ -12,28 +18,58 @@
 /*                                                                   */
 /* ***************************************************************** */
 
-symbol *Root_ST = NULL;
+/* The symbol table is a list, starting at a->Root_ST, for walking
+   through all the symbols.  To find one, its name is interned
+   (intern.c), and the interned name points to its symbol.  The
+   symbol's name is the interned name's spelling.
 
-symbol *search_symbol(char *name)
-{
-    symbol *s;
-    for (s = Root_ST; s != NULL; s = s->next)
-        if (strcasecmp(name, s->name) == 0) break;
+   Symbols are never freed one at a time: they, their names, and the
+   fixups are all in the a->symbol_space arena, and are released in
+   one go at the end of the assembly. */
 
-    return(s);
+symbol *search_symbol(Assembly *a, const char *name, int length)
+{
+    return(intern_name(a, name, length)->sy);
 }
 
-symbol *insert_symbol(char *name)
+symbol *insert_symbol(Assembly *a, struct interned_name *name)
 {
     symbol *s;
+    enum stats_phase saved = STATS_ENTER(a, PHASE_SYMBOLS);
+    size_t before = a->symbol_space.allocated;
 
-    s = TYPED_MALLOC(symbol);
-    s->name = remember_string(name);
+    s = CAST(symbol *, arena_alloc(&a->symbol_space, sizeof(symbol)));
+    s->name = name->spelling;
     s->value = 0;
-    s->fr = NULL;
-    s->next = Root_ST;
-    Root_ST = s;
+    s->defined = FALSE;
+    s->global = FALSE;
+    s->external = FALSE;
+    s->number = 0;
+    s->defining_line = 0;
+    s->defining_file = 0;
+    s->reference_line = 0;
+    s->next = a->Root_ST;
+    a->Root_ST = s;
+    name->sy = s;
 
+    if (a->stats != NULL)
+        {
+            a->stats->symbols += 1;
+            STATS_ALLOCATED(a, a->symbol_space.allocated - before);
+        }
+    STATS_LEAVE(a, saved);
+    return(s);
+}
+
+/* the symbol with this name, which need not be defined (yet) */
+symbol *declare_symbol(Assembly *a, struct interned_name *name, int line_number)
+{
+    symbol *s = name->sy;
+    if (s == NULL)
+        {
+            s = insert_symbol(a, name);
+            s->reference_line = line_number;
+        }
     return(s);
 }
 
@@ -43,46 +79,136 @@ symbol *insert_symbol(char *name)
 /*                                                                   */
 /* ***************************************************************** */
 
-void  handle_forward_references(symbol *s)
+/* Forward references are not fixed up as each symbol is defined.
+   Instead we remember each one in an array, which grows as needed,
+   and fix them all up in one pass at the end, in address order.
+   This avoids allocating (and freeing) a node per reference. */
+
+void forward_reference(Assembly *a, struct interned_name *name, int line_number, Address reference_address, Boolean full)
 {
-    /* plug the new address into those instructions
-       that referenced it */
-    while (s->fr != NULL)
+    if (a->debug) fprintf(a->errors, "%s forward reference to %s at line %d, address 0x%03X\n",
+                       (full ? "full" : "page"),
+                       name->spelling, line_number, reference_address);
+
+    /* get a symbol table entry; define one if necessary */
+    symbol *s = name->sy;
+    if (s == NULL)
+        s = insert_symbol(a, name);
+    s->reference_line = line_number;
+
+    add_fixup(a, s, reference_address, full, line_number);
+}
+
+void add_fixup(Assembly *a, symbol *s, Address reference_address, Boolean full, int line_number)
+{
+    enum stats_phase saved = STATS_ENTER(a, PHASE_SYMBOLS);
+
+    /* make sure there is room for another one: a new array twice the
+       size; the old one stays in the arena, but all of them together
+       are no bigger than the last */
+    if (a->number_of_fixups >= a->max_fixups)
         {
-            /* remove the forward note from the list */
-            struct forward_reference_node *fr = s->fr;
-            s->fr = fr->next;
-            if (fr->full)
-                Define_Object_Code(fr->addr, s->value, TRUE);
-            else
-                {
-                    INST inst = Fetch_Object_Code(fr->addr);
-                    inst = Adjust_for_ZC(fr->addr, inst, s->value);
-                    Define_Object_Code(fr->addr, inst, TRUE);
-                }
-            free(fr);
+            size_t before = a->symbol_space.allocated;
+            a->max_fixups = (a->max_fixups == 0) ? 256 : 2*a->max_fixups;
+            struct fixup *fixups = CAST(struct fixup *, arena_alloc(&a->symbol_space, a->max_fixups * sizeof(struct fixup)));
+            if (a->number_of_fixups > 0)
+                memcpy(fixups, a->fixups, a->number_of_fixups * sizeof(struct fixup));
+            a->fixups = fixups;
+            STATS_ALLOCATED(a, a->symbol_space.allocated - before);
         }
+
+    struct fixup *f = &a->fixups[a->number_of_fixups];
+    f->sy = s;
+    f->expression = NULL;
+    f->relocate = FALSE;
+    f->addr = reference_address;
+    f->full = full;
+    f->line_number = line_number;
+    f->order = a->number_of_fixups;
+    a->number_of_fixups += 1;
+
+    if (a->stats != NULL) a->stats->fixups += 1;
+    STATS_LEAVE(a, saved);
 }
 
-void forward_reference(char *name, int line_number, Address reference_address, Boolean full)
+
+/* sort by address; for the same address, keep them in the order
+   they were made, so the last one wins */
+int compare_fixups(const void *p, const void *q)
 {
-    if (debug) fprintf(stderr, "%s forward reference to %s at line %d, address 0x%03X\n",
-                       (full ? "full" : "page"),
-                       name, line_number, reference_address);
+    const struct fixup *f = CAST(const struct fixup *, p);
+    const struct fixup *g = CAST(const struct fixup *, q);
+    if (f->addr != g->addr) return(f->addr - g->addr);
+    return(f->order - g->order);
+}
 
-    /* get a symbol table entry; define one if necessary */
-    symbol *s = search_symbol(name);
-    if (s == NULL)
-        s = insert_symbol(name);
+void Resolve_Forward_References(Assembly *a)
+{
+    if (a->number_of_fixups > 1)
+        qsort(a->fixups, a->number_of_fixups, sizeof(struct fixup), compare_fixups);
 
-    struct forward_reference_node *fr = TYPED_MALLOC(struct forward_reference_node);
-    fr->addr = reference_address;
-    fr->full = full;
-    fr->line_number = line_number;
+    /* An EXTERN symbol may end up on any page, so a memory reference
+       to it goes through a link on this page, which the linker fills
+       in (Place_Literals).  Only one already indirect (JMS I X) is
+       left to the linker, which needs X on page zero. */
+    int i;
+    int kept = 0;
+    for (i = 0; i < a->number_of_fixups; i++)
+        {
+            struct fixup *f = &a->fixups[i];
+            if ((f->expression == NULL) && f->sy->external && !f->full)
+                {
+                    INST inst = Fetch_Object_Code(a, f->addr);
+                    if ((inst & 0x100) == 0)
+                        {
+                            literal_reference(a, f->addr, f->sy, NULL, 0, TRUE, f->line_number);
+                            Define_Object_Code(a, f->addr, inst | 0x100, TRUE);
+                            continue;
+                        }
+                }
+            a->fixups[kept++] = *f;
+        }
+    a->number_of_fixups = kept;
 
-    /* link this into the list */
-    fr->next = s->fr;
-    s->fr = fr;
+    /* plug the address of each symbol into those instructions
+       that referenced it */
+    for (i = 0; i < a->number_of_fixups; i++)
+        {
+            struct fixup *f = &a->fixups[i];
+            symbol *s = f->sy;
+            Address value;
+
+            /* undefined symbols are reported later */
+            if (f->expression != NULL)
+                {
+                    if (Undefined_In_Expression(f->expression) != NULL) continue;
+                    int relocation;
+                    value = Evaluate_Expression(a, f->expression, &relocation, f->line_number) & 0xFFF;
+                    f->relocate = (relocation == 1);
+                    if ((relocation != 0) && (relocation != 1))
+                        {
+                            Report_Error(a, f->line_number, "Expression can not be relocated");
+                        }
+                }
+            else if (!s->defined)
+                continue;
+            else
+                value = s->value;
+
+            if (f->full)
+                Define_Object_Code(a, f->addr, value, TRUE);
+            else
+                {
+                    INST inst = Fetch_Object_Code(a, f->addr);
+                    inst = memory_reference(a, f->addr, inst, (f->expression == NULL) ? s : NULL, f->expression, value,
+                                            f->line_number);
+                    Define_Object_Code(a, f->addr, inst, TRUE);
+                }
+        }
+
+    /* a relocatable assembly still needs them (reloc.c) */
+    if (!a->relocatable)
+        a->number_of_fixups = 0;
 }
 
 
@@ -93,30 +219,32 @@ void forward_reference(char *name, int line_number, Address reference_address, B
 /* ***************************************************************** */
 
 
-void define_symbol(char *name, Address value)
+void define_symbol(Assembly *a, struct interned_name *name, Address value)
 {
-    symbol *s = search_symbol(name);
+    symbol *s = name->sy;
 
     if (s == NULL)
-        s = insert_symbol(name);
-    else if (s->fr == NULL)
+        s = insert_symbol(a, name);
+    else if (s->external)
         {
-            number_of_errors += 1;
-            fprintf(stderr, "symbol %s redefined; old value = 0x%03X, new value = 0x%03X\n", name, s->value, value);
+            Report_Error(a, a->line_number, "EXTERN symbol %s defined", s->name);
+        }
+    else if (s->defined)
+        {
+            Report_Error(a, a->line_number, "symbol %s redefined; old value = 0x%03X, new value = 0x%03X",
+                         s->name, s->value, value);
         }
     else
         {
-            if (debug) fprintf(stderr, "symbol %s defined; value = 0x%03X\n", s->name, s->value);
+            if (a->debug) fprintf(a->errors, "symbol %s defined; value = 0x%03X\n", s->name, s->value);
         }
 
-    /* define the new value */
+    /* define the new value; any forward references to it are
+       fixed up at the end (Resolve_Forward_References) */
     s->value = value;
-
-    /* if there were forward references, walk the list and define them */
-    if (s->fr != NULL)
-        {
-            handle_forward_references(s);
-        }
+    s->defined = TRUE;
+    s->defining_line = a->line_number;
+    s->defining_file = a->file_number;
 }
 
 
@@ -127,18 +255,26 @@ void define_symbol(char *name, Address value)
 /* ***************************************************************** */
 
 
-void Check_for_undefined_symbols(void)
+void Check_for_undefined_symbols(Assembly *a)
 {
     /* walk the entire symbol table */
-    /* look to see if anyone has an non-empty list of forward references */
+    /* look to see if anyone was referenced but never defined */
     symbol *s;
-    for (s = Root_ST; s != NULL; s = s->next)
-        if (s->fr != NULL)
+    for (s = a->Root_ST; s != NULL; s = s->next)
+        if (!s->defined && !s->external)
             {
-                number_of_errors += 1;
-                fprintf(stderr, "Undefined symbol %s used at line %d\n",
-                        s->name, s->fr->line_number);
+                Report_Error(a, s->reference_line, "Undefined symbol %s used", s->name);
             }
 }
 
 
+/* free the symbol table and the forward references */
+void Release_Symbol_Table(Assembly *a)
+{
+    Release_Names(a);
+    arena_release(&a->symbol_space);
+    a->Root_ST = NULL;
+    a->fixups = NULL;
+    a->number_of_fixups = 0;
+    a->max_fixups = 0;
+}
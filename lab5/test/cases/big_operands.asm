@@ -0,0 +1,13 @@
+/ operands too big for an int wrap around; only 12 bits are kept
+        ORIG 0x100
+START,  CLA
+        TAD A
+        HLT
+A,      2147483647 * 2
+B,      -2147483648
+C,      0-2147483647-2
+D,      -2147483648 % -1
+E,      2047*2047*2047
+F,      4294967295 + 2
+G,      -65535 * 65535
+        END START
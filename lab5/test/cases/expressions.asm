@@ -0,0 +1,22 @@
+/ operand expressions: symbols, ., forward references and literals
+        ORIG 0x80
+START,  CLA
+        TAD TBL+2               / a symbol plus a constant
+        TAD TEND-TBL            / the difference of two addresses
+        TAD SIZE*2+1            / precedence: * before +
+        TAD -SIZE&0x7F          / negation, and &
+        JMP .+2                 / the location counter
+        HLT
+        ISZ .-1
+        TAD (SIZE%2|0x40)       / a literal with an expression
+        TAD (LATER+3)           / a literal with a forward reference
+        TAD I (TBL+1)           / and to a table on this page
+        JMP START
+SIZE,   6
+TBL,    1
+        2
+        3
+TEND,   .
+        ORIG 0x100
+LATER,  LATER-.+TBL             / a forward reference, now defined
+        END START
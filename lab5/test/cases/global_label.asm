@@ -0,0 +1,10 @@
+/ GLOBAL and EXTERN are only pseudo-ops with -r; here they are labels
+        ORIG 0x80
+START,  CLA
+        TAD GLOBAL
+        TAD I EXTERN
+        DCA GLOBAL
+        JMP START
+GLOBAL, 5
+EXTERN, GLOBAL
+        END START
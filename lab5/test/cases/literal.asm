@@ -0,0 +1,17 @@
+/ literals and links to other pages
+        ORIG 0x80
+START,  CLA
+        TAD (5)
+        TAD (5)
+        TAD (0x7FF)
+        DCA FARV
+        JMS SUB
+        TAD I (FARV)
+        JMP START
+        ORIG 0x200
+FARV,   0
+SUB,    0
+        TAD (5)
+        TAD (START)
+        JMP I SUB
+        END START
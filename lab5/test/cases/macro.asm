@@ -0,0 +1,20 @@
+/ INCLUDE, MACRO and REPT
+        INCLUDE "macro.inc"
+        ORIG 0x80
+START,  ADDTO A, B      / A = A + B
+        CLEAR 3, TBL
+LOOP,   REPT 2
+        IAC
+        ENDM
+        ADDTO A, C
+        HLT
+PTR,    0
+TBL,    TABLE
+A,      1
+B,      2
+C,      'C'
+        ORIG 0x100
+TABLE,  REPT 3
+        7
+        ENDM
+        END START
@@ -0,0 +1,9 @@
+/ calls SUB, in sub.asm, with no I: the assembler puts in a link
+        EXTERN SUB, COUNT
+        ORIG 0x80
+START,  CLA
+        JMS SUB
+        JMS SUB
+        TAD COUNT
+        HLT
+        END START
@@ -0,0 +1,7 @@
+/ linked after main.asm, so on another page
+        GLOBAL SUB, COUNT
+        ORIG 0x80
+SUB,    0
+        ISZ COUNT
+        JMP I SUB
+COUNT,  0
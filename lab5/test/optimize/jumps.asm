@@ -0,0 +1,11 @@
+/ -O: a JMP to a JMP goes straight to where the last one goes, but
+/ no further than a JMP I
+        ORIG 0x80
+START,  JMP A
+        HLT
+A,      JMP B
+B,      JMP C
+C,      JMP I PTR
+DONE,   HLT
+PTR,    DONE
+        END START
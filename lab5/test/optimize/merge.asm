@@ -0,0 +1,11 @@
+/ -O: CLA followed by IAC is one CLA IAC, and CLA CLA is CLA
+        ORIG 0x80
+START,  CLA
+        IAC
+        DCA ONE
+        CLA
+        CLA
+        TAD ONE
+        HLT
+ONE,    0
+        END START
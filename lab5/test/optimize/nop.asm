@@ -0,0 +1,16 @@
+/ -O: a NOP taken out moves the rest of its page down a word, and
+/ everything that refers to it: labels, memory references and the
+/ words that hold addresses
+        ORIG 0x80
+START,  CLA
+        TAD X
+        NOP
+        JMS SUB
+        TAD I PTR
+        JMP START
+X,      5
+PTR,    X
+SUB,    0
+        NOP
+        JMP I SUB
+        END START
@@ -13,6 +13,7 @@ function testcore {
 	ref=$2
 	out=$3
 	cmptool=$4
+	listing=$5
 	blank=$CASEDIR/blank
 	log=$TMPDIR/$TESTCASE.log
 	stdout=$TMPDIR/$TESTCASE.stdout
@@ -26,6 +27,17 @@ function testcore {
 		echo "error: $CMP"
 	fi
 
+	# a case with a .lst file checks the listing too
+	if [ -n "$listing" ] && [ -f $listing ]
+	then
+		CMP=`$cmptool $listing $stdout`
+		if [ $? != 0 ]
+		then
+			FAILED=1
+			echo "error: $CMP"
+		fi
+	fi
+
 	LOG=`$cmptool --quiet $blank $log`
 	if [ $? != 0 ]
 	then
@@ -76,15 +88,124 @@ then
 	mkdir $TMPDIR
 fi
 
-rm -f $TMPDIR/*
+rm -rf $TMPDIR/*
 rm -f $CASEDIR/*.out
 
 for i in `ls $CASEDIR/*.asm`
 do
 	base="${i%.*}"
-	testfunc $base testcore "./$PROG $base.asm" "$base.obj"  "$base.out" "cmp"
+	testfunc $base testcore "./$PROG $base.asm" "$base.obj"  "$base.out" "cmp" "$base.lst"
 done
 
+# the same source in two directories, each with its own include
+# file: the cache (-C) must not hand the second the first one's object
+function testcache {
+	dir=$TMPDIR/cache
+	rm -rf $dir
+	mkdir -p $dir/cache $dir/d1 $dir/d2
+	for d in 1 2
+	do
+		printf '        INCLUDE "defs.inc"\n        ORIG 0x80\nSTART,  TAD VAL\n        HLT\n        END START\n' > $dir/d$d/a.asm
+		printf '        ORIG 0x10\nVAL,    %d\n' $d > $dir/d$d/defs.inc
+	done
+	./$PROG -N $dir/d2/a.asm
+	mv $dir/d2/a.out $dir/d2/a.obj
+	testcore "./$PROG -N -C $dir/cache $dir/d1/a.asm && ./$PROG -N -C $dir/cache $dir/d2/a.asm" "$dir/d2/a.obj" "$dir/d2/a.out" "cmp"
+}
+
+testfunc "cache with INCLUDE in two directories" testcache
+
+# an INCLUDE file that is not there yet: the failed assembly must not
+# be cached, so once the file is made, the cache gives the new result
+function testcachemissing {
+	dir=$TMPDIR/cachemissing
+	rm -rf $dir
+	mkdir -p $dir/cache
+	printf '        INCLUDE "defs.inc"\n        ORIG 0x80\nSTART,  TAD VAL\n        HLT\n        END START\n' > $dir/a.asm
+	./$PROG -N -C $dir/cache $dir/a.asm 2> /dev/null
+	printf '        ORIG 0x10\nVAL,    3\n' > $dir/defs.inc
+	./$PROG -N $dir/a.asm
+	mv $dir/a.out $dir/a.obj
+	testcore "./$PROG -N -C $dir/cache $dir/a.asm" "$dir/a.obj" "$dir/a.out" "cmp"
+}
+
+testfunc "cache with an INCLUDE file made later" testcachemissing
+
+# two relocatable modules, linked: main.asm uses SUB and COUNT, from
+# sub.asm, which link8 puts on another page
+function testlink {
+	dir=$TMPDIR/link
+	rm -rf $dir
+	mkdir -p $dir
+	cp link/*.asm $dir
+	testcore "./$PROG -N -r $dir/main.asm && ./$PROG -N -r $dir/sub.asm && ../link8 -o $dir/link.out $dir/main.rel $dir/sub.rel" "link/link.obj" "$dir/link.out" "cmp"
+}
+
+testfunc "link8 with EXTERN memory references" testlink
+
+# the symbol map (-M) read back: obj8dump -s names the addresses, and
+# will not use a map that is not sorted (unsorted.sym has its first
+# two symbols the wrong way round) or whose index by name misses a
+# symbol (unindexed.sym)
+function testsymmap {
+	dir=$TMPDIR/symmap
+	rm -rf $dir
+	mkdir -p $dir
+	cp $CASEDIR/literal.asm $dir
+	testcore "./$PROG -N -M $dir/literal.asm && ../obj8dump -s $dir/literal.sym $dir/literal.out" "symmap/literal.dump" "$TMPDIR/$TESTCASE.stdout" "cmp"
+}
+
+function testbadsymmap {
+	dir=$TMPDIR/symmap
+	mkdir -p $dir
+	echo rejected > $dir/rejected
+	testcore "{ ../obj8dump -s $1 $CASEDIR/literal.obj || echo rejected; }" "$dir/rejected" "$TMPDIR/$TESTCASE.stdout" "cmp"
+}
+
+testfunc "symbol map read by obj8dump" testsymmap
+testfunc "unsorted symbol map refused" testbadsymmap symmap/unsorted.sym
+testfunc "unindexed symbol map refused" testbadsymmap symmap/unindexed.sym
+
+# the peephole optimizer (-O): operate instructions merged, NOPs
+# taken out (and what referred to the words after them moved), and
+# jumps to jumps threaded
+function testoptimize {
+	dir=$TMPDIR/optimize
+	mkdir -p $dir
+	cp optimize/$1.asm $dir
+	testcore "./$PROG -O $dir/$1.asm" "optimize/$1.obj" "$dir/$1.out" "cmp"
+}
+
+rm -rf $TMPDIR/optimize
+testfunc "-O merging operate instructions" testoptimize merge
+testfunc "-O taking out NOPs" testoptimize nop
+testfunc "-O threading jumps" testoptimize jumps
+
+# a division by zero found only when a forward reference is fixed up
+# is reported at the line of the expression
+function testdivide {
+	dir=$TMPDIR/divide
+	rm -rf $dir
+	mkdir -p $dir
+	printf '        ORIG 0x80\nSTART,  TAD 6%%ZERO\n        HLT\n        ORIG 0\nZERO,   0\n        END START\n' > $dir/divide.asm
+	echo "Division by zero in expression at line 2" > $dir/expected
+	testcore "./$PROG $dir/divide.asm 2>&1 >/dev/null | grep Division" "$dir/expected" "$TMPDIR/$TESTCASE.stdout" "cmp"
+}
+
+testfunc "division by zero in a forward reference" testdivide
+
+# the cross reference (-X) of symbols used in the source file and in
+# an INCLUDE file: each file's lines kept apart, and in order
+function testxref {
+	dir=$TMPDIR/xref
+	rm -rf $dir
+	mkdir -p $dir
+	cp xref/xref.asm xref/defs.inc $dir
+	testcore "./$PROG -X $dir/xref.asm" "xref/xref.obj" "$dir/xref.out" "cmp" "xref/xref.lst"
+}
+
+testfunc "cross reference with an INCLUDE file" testxref
+
 let "TESTPASS=TESTCASE-TESTFAIL"
 if [ $TESTPASS -eq $TESTCASE ]
 then
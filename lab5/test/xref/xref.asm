@@ -0,0 +1,9 @@
+/ the cross reference (-X), with symbols used in an INCLUDE file
+        ORIG 0x80
+START,  TAD V1
+        JMS SUB
+        INCLUDE "defs.inc"
+        ORIG 0x90
+        TAD V2
+        JMP START
+        END START
@@ -5,69 +5,235 @@
 
 
 #include <ctype.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "asm8.h"
 #include "token.h"
+#include "stats.h"
+#include "intern.h"
+#include "xref.h"
 
 /* ***************************************************************** */
 /*                                                                   */
 /*                                                                   */
 /* ***************************************************************** */
 
-char *input_buffer = NULL;
-int buffer_length = 0;
-int input_line_length = 0;
-int line_number;
-int token_index = 0;
+/* If the input is a regular file, we read the whole thing into memory
+   at once, and then just find the lines in it.  Each line is
+   terminated (in place) by replacing its newline with a null.
 
-void save_char(char c)
+   The caller can also hand us the whole input: a malloc'ed buffer,
+   one byte longer than the input, in a->file_buffer and
+   a->file_length.  It is freed with the rest of the assembly. */
+
+void load_input_file(Assembly *a)
+{
+    struct stat st;
+
+    /* the caller may have already read it for us */
+    if (a->file_buffer != NULL)
+        return;
+
+    /* pipes and terminals are read a character at a time, below */
+    if ((fstat(fileno(a->input), &st) != 0) || !S_ISREG(st.st_mode))
+        return;
+
+    /* one extra byte, so we can always terminate the last line */
+    a->file_buffer = CAST(char *, malloc(st.st_size + 1));
+    if (a->file_buffer == NULL)
+        return;
+    STATS_ALLOCATED(a, st.st_size + 1);
+    a->file_length = fread(a->file_buffer, 1, st.st_size, a->input);
+    a->file_buffer[a->file_length] = '\0';
+    a->file_position = 0;
+}
+
+void release_input_file(Assembly *a)
+{
+    if (a->file_buffer != NULL)
+        {
+            free(a->file_buffer);
+            a->file_buffer = NULL;
+        }
+    a->file_length = 0;
+    a->file_position = 0;
+}
+
+/* find the next line in the file buffer */
+int get_next_line_from_buffer(Assembly *a)
+{
+    char *line = &a->file_buffer[a->file_position];
+    long left = a->file_length - a->file_position;
+    char *nl = CAST(char *, memchr(line, '\n', left));
+
+    a->input_buffer = line;
+    if (nl == NULL)
+        {
+            /* a last line with no newline is treated as EOF, the
+               same as when reading character by character */
+            a->input_line_length = left + 1;
+            a->file_position = a->file_length;
+            return(EOF);
+        }
+
+    *nl = '\0';
+    a->input_line_length = (nl - line) + 1;
+    a->file_position += a->input_line_length;
+    return(a->input_line_length);
+}
+
+/* ***************************************************************** */
+
+/* otherwise, lines are read a character at a time into a buffer
+   that grows as needed */
+
+void save_char(Assembly *a, char c)
 {
     /* make sure we have room for this character in the input buffer */
-    if (input_line_length >= buffer_length-1)
+    if (a->input_line_length >= a->buffer_length-1)
         {
-            if (buffer_length == 0)
-                buffer_length = 256;
+            if (a->buffer_length == 0)
+                a->buffer_length = 256;
             else
-                buffer_length = 2*buffer_length;
-            input_buffer = realloc(input_buffer, buffer_length);
+                a->buffer_length = 2*a->buffer_length;
+            a->line_buffer = realloc(a->line_buffer, a->buffer_length);
+            STATS_ALLOCATED(a, a->buffer_length);
         }
-    input_buffer[input_line_length] = c;
-    input_line_length += 1;
+    a->line_buffer[a->input_line_length] = c;
+    a->input_line_length += 1;
 }
 
-/* read the next line of input, and set the token pointer to the
-   beginning of the line */
-int get_next_line(void)
+/* read the next line of the source file, and set the token pointer
+   to the beginning of the line.  The assembler gets its lines through
+   the preprocessor (get_next_line, in macro.c). */
+int read_source_line(Assembly *a)
 {
+    a->source_line_number += 1;
+    a->token_index = 0;
+
+    if (a->file_buffer != NULL)
+        return(get_next_line_from_buffer(a));
+
     int c;
-    while (((c = getc(input)) != EOF) && (c != '\n'))
+    while (((c = getc(a->input)) != EOF) && (c != '\n'))
         {
-            save_char(c);
+            save_char(a, c);
         }
-    save_char('\0');
-    line_number += 1;
-    token_index = 0;
+    save_char(a, '\0');
+    a->input_buffer = a->line_buffer;
 
-    if ((c == EOF) || (input_line_length == 0))
+    if ((c == EOF) || (a->input_line_length == 0))
         return(EOF);
     else
-        return(input_line_length);
+        return(a->input_line_length);
+}
+
+/* ***************************************************************** */
+
+/* The listing is formatted by hand into a large buffer, and written
+   out only when the buffer fills (or at the end of the file).  Going
+   through fprintf three times per line made the listing the most
+   expensive part of assembling a large file.  If the listing is
+   going to a terminal, we write each line as we finish it. */
+
+void flush_listing(Assembly *a)
+{
+    if (a->listing_length > 0)
+        fwrite(a->listing_buffer, 1, a->listing_length, a->listing_file);
+    a->listing_length = 0;
+}
+
+/* same as printf("0x%03X", n) */
+char *put_hex(char *p, unsigned int n)
+{
+    static const char hex_digits[] = "0123456789ABCDEF";
+    int digits = 3;
+    while ((digits < 8) && ((n >> (4*digits)) != 0)) digits += 1;
+
+    *p++ = '0';
+    *p++ = 'x';
+    while (digits > 0)
+        {
+            digits -= 1;
+            *p++ = hex_digits[(n >> (4*digits)) & 0xF];
+        }
+    return(p);
+}
+
+/* same as printf("%5d", n), for n >= 0 */
+char *put_decimal(char *p, int n)
+{
+    char digits[16];
+    int i = 0;
+    do {
+        digits[i++] = '0' + (n % 10);
+        n = n / 10;
+    } while (n > 0);
+
+    int pad;
+    for (pad = i; pad < 5; pad++) *p++ = ' ';
+    while (i > 0) *p++ = digits[--i];
+    return(p);
 }
 
 /* print out this line and it's contents (if there are any) */
-void finish_this_line(Address location_counter, INST instruction)
+void list_this_line(Assembly *a)
 {
-    fprintf(stdout, "  ");
-    if (good_stuff)
+    if (!a->listing)
+        {
+            a->input_line_length = 0;
+            return;
+        }
+
+    if (a->listing_to_terminal < 0)
+        a->listing_to_terminal = isatty(fileno(a->listing_file));
+
+    /* make sure there is room for the longest possible prefix
+       ("  0x%03X: 0x%03X%5d: " with the widest numbers) and
+       the line itself */
+    int n = strlen(a->input_buffer);
+    if (a->listing_length + 64 + n + 1 > LISTING_BUFFER_SIZE)
+        flush_listing(a);
+
+    char *p = &a->listing_buffer[a->listing_length];
+    *p++ = ' ';
+    *p++ = ' ';
+    if (a->good_stuff)
         {
-            fprintf(stdout, "0x%03X: 0x%03X", location_counter, instruction);
+            p = put_hex(p, a->location_counter);
+            *p++ = ':';
+            *p++ = ' ';
+            p = put_hex(p, a->instruction);
         }
     else
         {
-            fprintf(stdout, "            ");
+            memset(p, ' ', 12);
+            p += 12;
         }
-    fprintf(stdout, "%5d: %s\n", line_number, input_buffer);
+    p = put_decimal(p, a->line_number);
+    *p++ = ':';
+    *p++ = ' ';
 
-    input_line_length = 0;
+    if (a->listing_length + 64 + n + 1 > LISTING_BUFFER_SIZE)
+        {
+            /* a line too long for the buffer; just write it */
+            a->listing_length = p - a->listing_buffer;
+            flush_listing(a);
+            fwrite(a->input_buffer, 1, n, a->listing_file);
+            p = a->listing_buffer;
+        }
+    else
+        {
+            memcpy(p, a->input_buffer, n);
+            p += n;
+        }
+    *p++ = '\n';
+    a->listing_length = p - a->listing_buffer;
+
+    if (a->listing_to_terminal)
+        flush_listing(a);
+
+    a->input_line_length = 0;
 }
 
 
@@ -76,37 +242,34 @@ void finish_this_line(Address location_counter, INST instruction)
 /*                                                                   */
 /* ***************************************************************** */
 
-char *copy_token_string(int i, int j)
-{
-    /* change j to '\0', so we can copy the string */
-    char save = input_buffer[j+1];
-    input_buffer[j+1]= '\0';
-    char *s = remember_string(&input_buffer[i]);
-    /* restore the input string, and update to just beyond this token */
-    input_buffer[j+1] = save;
-    return(s);
-}
-
 /* look at the next token to see what it will be */
 /* only need to look one character ahead */
-enum Token_type peek_token_type(void)
+enum Token_type peek_token_type(Assembly *a)
 {
     /* skip any leading spaces */
     // Do not skip commas
-    while ((token_index < input_line_length)
-           && (isspace(input_buffer[token_index]))
-           ) token_index += 1;
+    while ((a->token_index < a->input_line_length)
+           && (isspace(a->input_buffer[a->token_index]))
+           ) a->token_index += 1;
     /* check for an empty line */
-    if (token_index >= input_line_length)  return(Tillegal);
-    if (input_buffer[token_index] == '\0') return(Tillegal);
+    if (a->token_index >= a->input_line_length)  return(Tillegal);
+    if (a->input_buffer[a->token_index] == '\0') return(Tillegal);
 
     /* colons are for labels */
     // Use comma for labels
-    if (input_buffer[token_index] == ',')   return(Tcolon);
+    if (a->input_buffer[a->token_index] == ',')   return(Tcolon);
 
     /* check for comments */
     // Use / for comments
-    if (input_buffer[token_index] == '/')   return(Tcomment);
+    if (a->input_buffer[a->token_index] == '/')   return(Tcomment);
+
+    /* parentheses are for literals */
+    if (a->input_buffer[a->token_index] == '(')   return(Tleft);
+    if (a->input_buffer[a->token_index] == ')')   return(Tright);
+
+    /* expressions (expr.c) */
+    if (strchr("+-*%&|", a->input_buffer[a->token_index]) != NULL) return(Toperator);
+    if (a->input_buffer[a->token_index] == '.')   return(Tdot);
 
     /* by symbol, we mean symbol or number */
     return(Tsymbol);
@@ -148,142 +311,162 @@ int digit_value(char c, int base)
 
 
 /* read a constant from the input buffer */
-Boolean parse_constant(Token *t, int *value)
+Boolean parse_constant(Assembly *a, Token *t, int *value)
 {
     /* remember where it starts */
-    int b0 = token_index;
+    int b0 = a->token_index;
     int base = 10;
-    int n = 0;
-    int sign = 1;
-
-    /* negative numbers */
-    if (input_buffer[token_index] == '-')
-        {
-            sign = -1;
-            token_index += 1;
-        }
+    unsigned int n = 0;         /* too many digits wrap around */
 
     /* base is decimal unless ... */
-    if (input_buffer[token_index] == '0')
+    if (a->input_buffer[a->token_index] == '0')
         {
             /* 0...  -- octal */
-            token_index += 1;
+            a->token_index += 1;
             base = 8;
-            if (input_buffer[token_index] == 'x')
+            if (a->input_buffer[a->token_index] == 'x')
                 {
                     /* 0x...  -- hex */
-                    token_index += 1;
+                    a->token_index += 1;
                     base = 16;
                 }
         }
-    while (is_valid_digit(input_buffer[token_index], base))
+    while (is_valid_digit(a->input_buffer[a->token_index], base))
         {
-            n = n * base + digit_value(input_buffer[token_index], base);
-            token_index += 1;
+            n = n * base + digit_value(a->input_buffer[a->token_index], base);
+            a->token_index += 1;
         }
-    *value = sign * n;
+    *value = CAST(int, n);
 
-    t->token_string = copy_token_string(b0, token_index);
+    /* the token is a view of the input buffer; nothing is copied */
+    t->token_string = &a->input_buffer[b0];
+    t->token_length = a->token_index - b0;
 
-    if (isalpha(input_buffer[token_index]))
+    if (isalpha(a->input_buffer[a->token_index]))
         return(FALSE);
     else
         return(TRUE);
 }
 
-void get_token(Token *t)
-{
-    /* check if we need to free the previous string */
-    if (t->token_string != NULL)
-        {
-            free(t->token_string);
-            t->token_string = NULL;
-        }
+/* Tokens are not copied: token_string points into the input buffer,
+   and token_length says how much of it is the token.  The string is
+   NOT null terminated, and is only good until the next line is read. */
 
-    enum Token_type a = peek_token_type();
-    if (a != Tsymbol)
+void scan_token(Assembly *a, Token *t)
+{
+    enum Token_type type = peek_token_type(a);
+    if (type != Tsymbol)
         {
-            t->type = a;
-            t->token_string = copy_token_string(token_index, token_index);
-            token_index += 1;
-            if (debug) fprintf(stderr, "next token: %s\n", t->token_string);
+            t->type = type;
+            t->token_string = &a->input_buffer[a->token_index];
+            t->token_length = (a->token_index < a->input_line_length) ? 1 : 0;
+            t->value = (t->token_length > 0) ? t->token_string[0] : 0;
+            a->token_index += 1;
+            if (a->debug) fprintf(a->errors, "next token: %.*s\n", t->token_length, t->token_string);
             return;
         }
 
-    if (isalpha(input_buffer[token_index]))
+    if (isalpha(a->input_buffer[a->token_index]))
         {
             int j;
-            for (j = token_index; j < input_line_length; j++)
+            for (j = a->token_index; j < a->input_line_length; j++)
                 {
-                    if (isalpha(input_buffer[j])) continue;
-                    if (isdigit(input_buffer[j])) continue;
-                    if (input_buffer[j] == '_') continue;
-                    if (input_buffer[j] == '.') continue;
+                    if (isalpha(a->input_buffer[j])) continue;
+                    if (isdigit(a->input_buffer[j])) continue;
+                    if (a->input_buffer[j] == '_') continue;
+                    if (a->input_buffer[j] == '.') continue;
                     /* not alpha, digit or underbar or period */
                     break;
                 }
             /* symbol is from token_index to j-1 */
-            t->token_string = copy_token_string(token_index, j-1);
-            token_index = j;
-            if (debug) fprintf(stderr, "next token: %s\n", t->token_string);
-
-            /* search to see if this token is an opcode */
-            opcode *op = search_opcode(t->token_string);
-            if (op != NULL)
+            t->token_string = &a->input_buffer[a->token_index];
+            t->token_length = j - a->token_index;
+            a->token_index = j;
+            if (a->debug) fprintf(a->errors, "next token: %.*s\n", t->token_length, t->token_string);
+
+            /* intern it: that tells us if it is an opcode,
+               or a known symbol.  GLOBAL and EXTERN are only
+               opcodes in a relocatable (-r) assembly; in any other
+               they are symbols, as they were before there was -r */
+            struct interned_name *name = intern_name(a, t->token_string, t->token_length);
+            t->name = name;
+            if ((name->op != NULL)
+                && (a->relocatable || ((name->op->class != k_global) && (name->op->class != k_extern))))
                 {
                     t->type = Topcode;
-                    t->op = op;
+                    t->op = name->op;
                     return;
                 }
 
-            /* search to see if this token is a known symbol */
-            symbol *sy = search_symbol(t->token_string);
-            if (sy != NULL)
-                {
-                    t->type = Tsymbol;
-                    t->sy = sy;
-                    t->value = sy->value;
-                    return;
-                }
-
-            /* we have a symbol that is not currently defined */
+            if (a->cross_reference) Note_Use(a, name);
             t->type = Tsymbol;
-            t->sy = NULL;
-            t->value = 0;
+            t->sy = name->sy;
+            if (name->sy != NULL)
+                t->value = name->sy->value;
+            else
+                t->value = 0;       /* a symbol that is not currently defined */
             return;
         }
 
-    /* A numeric constant */
-    else if (isdigit(input_buffer[token_index]) || (input_buffer[token_index] == '-'))
+    /* A numeric constant; a - in front of one is an operator (expr.c) */
+    else if (isdigit(a->input_buffer[a->token_index]))
         {
             int value;
-            if (parse_constant(t, &value))
+            if (parse_constant(a, t, &value))
                 {
                     t->type = Tconstant;
                     t->value = value;
-                    if (debug) fprintf(stderr, "next token: constant %d\n", t->value);
+                    if (a->debug) fprintf(a->errors, "next token: constant %d\n", t->value);
                     return;
                 }
         }
 
-    /* A character constant: '.'  */
-    else if ((input_buffer[token_index] == '\'') && (input_buffer[token_index+2] == '\''))
+    /* A character constant: '.'  (all three on the line) */
+    else if ((a->input_buffer[a->token_index] == '\'') && (a->token_index + 2 < a->input_line_length)
+             && (a->input_buffer[a->token_index+2] == '\''))
         {
             t->type = Tconstant;
-            t->value = input_buffer[token_index+1];
-            t->token_string = malloc(4);
-            t->token_string[0] = t->token_string[2] = '\'';
-            t->token_string[1] = t->value;
-            t->token_string[3] = '\0';
-            token_index += 3;
-            if (debug) fprintf(stderr, "next token: char constant %d (%c)\n", t->value, t->value);
+            t->value = a->input_buffer[a->token_index+1];
+            t->token_string = &a->input_buffer[a->token_index];
+            t->token_length = 3;
+            a->token_index += 3;
+            if (a->debug) fprintf(a->errors, "next token: char constant %d (%c)\n", t->value, t->value);
             return;
         }
 
     /* and anything else is just illegal */
     /* should we advance the token_index here? */
     t->type = Tillegal;
-    if (debug) fprintf(stderr, "next token: illegal\n");
+    if (a->debug) fprintf(a->errors, "next token: illegal\n");
     return;
 }
 
+
+
+/* ***************************************************************** */
+
+/* the entry points, counted and timed with -S */
+
+void finish_this_line(Assembly *a)
+{
+    if (a->stats == NULL)
+        {
+            list_this_line(a);
+            return;
+        }
+    enum stats_phase saved = Enter_Phase(a->stats, PHASE_LISTING);
+    list_this_line(a);
+    STATS_LEAVE(a, saved);
+}
+
+void get_token(Assembly *a, Token *t)
+{
+    if (a->stats == NULL)
+        {
+            scan_token(a, t);
+            return;
+        }
+    enum stats_phase saved = Enter_Phase(a->stats, PHASE_TOKENS);
+    scan_token(a, t);
+    STATS_LEAVE(a, saved);
+}
@@ -24,16 +24,24 @@ enum Token_type
     Tsymbol,
     Tconstant,
     Tcomment,
+    Tleft,              /* ( and ), around a literal */
+    Tright,
+    Toperator,          /* + - * % & |, in an expression (expr.h) */
+    Tdot,               /* . the location counter */
+    Texpression,        /* made by parse_operand, from the tokens above */
     Tillegal
 };
 
 struct Token
 {
     enum Token_type  type;
-    char *token_string;
-    opcode *op;
+    char *token_string;     /* points into the input line; not null terminated */
+    int   token_length;
+    struct interned_name *name; /* Topcode, Tsymbol: the identifier */
+    const opcode *op;
     symbol *sy;
-    int    value;
+    int    value;               /* the operator, for Toperator */
+    const struct expression *ex;   /* Texpression */
 };
 typedef struct Token Token;
 
@@ -42,13 +50,13 @@ typedef struct Token Token;
 /*                                                                   */
 /* ***************************************************************** */
 
-/* variables */
-int line_number;
-
 /* prototypes */
-int get_next_line(void);
-void finish_this_line(Address location_counter, INST instruction);
-enum Token_type peek_token_type(void);
-void get_token(Token *t);
+void load_input_file(Assembly *a);
+void release_input_file(Assembly *a);
+int read_source_line(Assembly *a);
+void finish_this_line(Assembly *a);
+void flush_listing(Assembly *a);
+enum Token_type peek_token_type(Assembly *a);
+void get_token(Assembly *a, Token *t);
 
 #endif
@@ -0,0 +1,140 @@
+/*
+   Assembler for PDP-8.  The cross reference (-X).  See xref.h.
+*/
+
+#include "asm8.h"
+#include "arena.h"
+#include "symbol.h"
+#include "intern.h"
+#include "stats.h"
+#include "macro.h"
+#include "xref.h"
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* name is on this line (of this file).  The lists are in
+   a->symbol_space, and grow as the fixups do (add_fixup). */
+void Note_Use(Assembly *a, struct interned_name *name)
+{
+    /* once is enough for each line */
+    if (name->number_of_uses > 0)
+        {
+            struct name_use *last = &name->uses[name->number_of_uses - 1];
+            if ((last->line_number == a->line_number) && (last->file_number == a->file_number))
+                return;
+        }
+
+    if (name->number_of_uses >= name->max_uses)
+        {
+            name->max_uses = (name->max_uses == 0) ? 4 : 2*name->max_uses;
+            struct name_use *uses = CAST(struct name_use *, arena_alloc(&a->symbol_space, name->max_uses * sizeof(struct name_use)));
+            if (name->number_of_uses > 0)
+                memcpy(uses, name->uses, name->number_of_uses * sizeof(struct name_use));
+            name->uses = uses;
+        }
+    struct name_use *u = &name->uses[name->number_of_uses++];
+    u->file_number = a->file_number;
+    u->line_number = a->line_number;
+}
+
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+int compare_names(const void *p, const void *q)
+{
+    const struct interned_name *x = *CAST(const struct interned_name * const *, p);
+    const struct interned_name *y = *CAST(const struct interned_name * const *, q);
+    return(strcmp(x->name, y->name));
+}
+
+/* the source file first, then each INCLUDE file in the order it was
+   first included; in each, by line */
+int compare_uses(const void *p, const void *q)
+{
+    const struct name_use *x = CAST(const struct name_use *, p);
+    const struct name_use *y = CAST(const struct name_use *, q);
+    if (x->file_number != y->file_number) return(x->file_number - y->file_number);
+    return(x->line_number - y->line_number);
+}
+
+/* sort the uses of name, and drop any line that is there twice (from
+   a file included twice, or a MACRO expanded on the line) */
+void sort_uses(struct interned_name *name)
+{
+    if (name->number_of_uses < 2) return;
+    qsort(name->uses, name->number_of_uses, sizeof(struct name_use), compare_uses);
+    int kept = 1;
+    int j;
+    for (j = 1; j < name->number_of_uses; j++)
+        {
+            if (compare_uses(&name->uses[j], &name->uses[kept - 1]) != 0)
+                name->uses[kept++] = name->uses[j];
+        }
+    name->number_of_uses = kept;
+}
+
+#define USES_PER_LINE 10
+
+void Write_Cross_Reference(Assembly *a, FILE *f)
+{
+    enum stats_phase saved = STATS_ENTER(a, PHASE_LISTING);
+
+    /* the names that are symbols; the others are opcodes */
+    struct interned_name **names = CAST(struct interned_name **, malloc((a->number_of_names + 1) * sizeof(struct interned_name *)));
+    int n = 0;
+    int i;
+    for (i = 0; i < a->max_names; i++)
+        {
+            struct interned_name *name;
+            for (name = a->names[i]; name != NULL; name = name->next)
+                if (name->sy != NULL) names[n++] = name;
+        }
+    if (n > 1) qsort(names, n, sizeof(struct interned_name *), compare_names);
+
+    fprintf(f, "\nCross reference:\n");
+    for (i = 0; i < n; i++)
+        {
+            symbol *s = names[i]->sy;
+            fprintf(f, "  %-12s", s->name);
+            if (s->external)
+                fprintf(f, " %-6s", "EXTERN");
+            else if (!s->defined)
+                fprintf(f, " %-6s", "undef");
+            else
+                fprintf(f, " 0x%03X ", s->value & 0xFFF);
+
+            /* each line is followed by a * or (unless it is the last
+               on the line) a space; a line of an INCLUDE file has the
+               file's name */
+            sort_uses(names[i]);
+            Boolean pad = FALSE;
+            int j;
+            for (j = 0; j < names[i]->number_of_uses; j++)
+                {
+                    struct name_use *u = &names[i]->uses[j];
+                    if ((j > 0) && (j % USES_PER_LINE == 0))
+                        {
+                            fprintf(f, "\n  %-12s %-6s", "", "");
+                            pad = FALSE;
+                        }
+                    if (u->file_number == 0)
+                        fprintf(f, "%s %5d", pad ? " " : "", u->line_number);
+                    else
+                        fprintf(f, "%s %s:%d", pad ? " " : "", Include_File_Name(a, u->file_number), u->line_number);
+                    pad = !(s->defined && (u->line_number == s->defining_line)
+                            && (u->file_number == s->defining_file));
+                    if (!pad) fputc('*', f);
+                }
+            fprintf(f, "\n");
+        }
+
+    free(names);
+    STATS_LEAVE(a, saved);
+}
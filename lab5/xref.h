@@ -0,0 +1,32 @@
+/*
+   Assembler for PDP-8.  The cross reference (-X).
+*/
+
+#ifndef _XREF_H_
+#define _XREF_H_
+
+#include "intern.h"
+
+/* ***************************************************************** */
+/*                                                                   */
+/*                                                                   */
+/* ***************************************************************** */
+
+/* With -X, get_token notes each line that each identifier is on, in
+   a list kept with its interned name (Note_Use); nothing is read
+   again.  At the end, the symbols are sorted by name, once, and
+   written after the listing:
+
+      Cross reference:
+        LOOP         0x012     12*    15    20
+
+   with the value of each symbol and the lines it is on; the line
+   that defined it is marked with a *.  The lines of the source file
+   come first, then those of each INCLUDE file, as defs.inc:3, in the
+   order the files were first included. */
+
+/* prototypes */
+void Note_Use(Assembly *a, struct interned_name *name);
+void Write_Cross_Reference(Assembly *a, FILE *f);
+
+#endif